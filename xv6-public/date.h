@@ -6,3 +6,8 @@ struct rtcdate {
   uint month;
   uint year;
 };
+
+struct timespec {
+  int tv_sec;
+  int tv_nsec;
+};
@@ -2,9 +2,13 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct kcache;
+struct kmemstat;
+struct lockstat;
 struct pipe;
 struct proc;
 struct rtcdate;
+struct slabstat;
 struct spinlock;
 struct sleeplock;
 struct stat;
@@ -43,6 +47,7 @@ struct inode*   idup(struct inode*);
 void            iinit(int dev);
 void            ilock(struct inode*);
 void            iput(struct inode*);
+void            itext(struct inode*, int);
 void            iunlock(struct inode*);
 void            iunlockput(struct inode*);
 void            iupdate(struct inode*);
@@ -64,10 +69,18 @@ extern uchar    ioapicid;
 void            ioapicinit(void);
 
 // kalloc.c
+void            getkmemstat(struct kmemstat*);
 char*           kalloc(void);
+char*           kallocpages(int);
 void            kfree(char*);
+void            kfreepages(char*, int);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+uint            knfree(void);
+int             krefcnt(char*);
+void            krefinc(char*);
+char*           kzalloc(void);
+int             kzerofill(void);
 
 // kbd.c
 void            kbdintr(void);
@@ -95,21 +108,26 @@ void            mpinit(void);
 void            picenable(int);
 void            picinit(void);
 
+// pagecache.c
+void            pcdrop(struct inode*);
+char*           pcget(struct inode*, uint, uint);
+void            pcinit(void);
+
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
+void            pipeinit(void);
 int             piperead(struct pipe*, char*, int);
 int             pipewrite(struct pipe*, char*, int);
 
 //PAGEBREAK: 16
 // proc.c
+void            calcload(void);
 int             cpuid(void);
 void            exit(void);
 int             fork(void);
 int             growproc(int);
 int             kill(int);
-struct cpu*     mycpu(void);
-struct proc*    myproc();
 void            pinit(void);
 void            procdump(void);
 void            scheduler(void) __attribute__((noreturn));
@@ -119,6 +137,7 @@ void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+void            wakeupone(void*);
 void            yield(void);
 
 // swtch.S
@@ -127,12 +146,22 @@ void            swtch(struct context**, struct context*);
 // spinlock.c
 void            acquire(struct spinlock*);
 void            getcallerpcs(void*, uint*);
+int             getlockstat(struct lockstat*, int);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
 
+// slab.c
+void*           kcachealloc(struct kcache*);
+struct kcache*  kcachecreate(char*, uint);
+void            kcachefree(struct kcache*, void*);
+void*           kmalloc(uint);
+void            kmfree(void*);
+int             getslabstat(struct slabstat*, int);
+void            slabinit(void);
+
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
@@ -151,17 +180,28 @@ char*           strncpy(char*, const char*, int);
 // syscall.c
 int             argint(int, int*);
 int             argptr(int, char**, int);
+int             argrdptr(int, char**, int);
 int             argstr(int, char**);
 int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
 void            syscall(void);
 
 // timer.c
-void            timerinit(void);
+int             nanosleep(int, int);
+int             sleepticks(int);
+void            timertick(void);
+
+// trace.c
+int             readtrace(pde_t*, uint, int);
+int             settrace(int);
+void            traceinit(void);
+void            tracerecord(int, struct proc*, struct proc*, int);
+void            tracerecordpid(int, struct proc*, int, int, int);
 
 // trap.c
 void            idtinit(void);
 extern uint     ticks;
+extern uint     tscpertick;
 void            tvinit(void);
 extern struct spinlock tickslock;
 
@@ -185,6 +225,8 @@ void            switchuvm(struct proc*);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
+int             pagefault(struct proc*, uint, uint);
+int             faultin(struct proc*, uint, uint, int);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
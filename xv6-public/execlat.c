@@ -0,0 +1,61 @@
+// Exec latency.
+//   execlat [nexecs [prog [args...]]]
+// Times nexecs fork() calls whose children exit at once, then
+// nexecs whose children exec prog (echo by default) with its
+// output closed. Reports the average TSC cycles from fork() to
+// wait() returning for each, and the difference, which is what
+// exec() and running prog cost.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+static char *defargv[] = { "echo", 0 };
+
+// Average cycles for a fork, an optional exec and the wait.
+static uint
+roundtrip(int n, char **argv)
+{
+  uint64 t0, total;
+  int i, pid;
+
+  total = 0;
+  for(i = 0; i < n; i++){
+    t0 = rdtsc();
+    pid = fork();
+    if(pid < 0){
+      printf(2, "execlat: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      if(argv){
+        close(1);
+        exec(argv[0], argv);
+        printf(2, "execlat: exec %s failed\n", argv[0]);
+      }
+      exit();
+    }
+    wait();
+    total += rdtsc() - t0;
+  }
+  return (uint)(total >> 10) / n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint fork, exec;
+  int n;
+
+  n = argc > 1 ? atoi(argv[1]) : 20;
+  if(n < 1)
+    n = 1;
+
+  fork = roundtrip(n, 0);
+  exec = roundtrip(n, argc > 2 ? argv + 2 : defargv);
+  printf(1, "execlat: %d runs of %s\n", n, argc > 2 ? argv[2] : defargv[0]);
+  printf(1, "KCYCLES FORK\tKCYCLES FORK+EXEC\tKCYCLES EXEC\n");
+  printf(1, "%d\t\t%d\t\t\t%d\n", fork, exec, exec - fork);
+  exit();
+}
@@ -14,8 +14,10 @@ struct inode {
   uint dev;           // Device number
   uint inum;          // Inode number
   int ref;            // Reference count
+  int ntext;          // Processes running this file, changed atomically
   struct sleeplock lock; // protects everything below here
   int valid;          // inode has been read from disk?
+  struct cpage *pages; // cached executable pages, see pagecache.c
 
   short type;         // copy of disk inode
   short major;
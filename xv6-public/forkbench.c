@@ -0,0 +1,89 @@
+// Fork/exit rate benchmark.
+//   forkbench [n] [inflight] [nproc]
+// Runs nproc copies of the loop in parallel (default 1). Each forks
+// n short-lived children, keeping up to inflight of them alive at
+// once. Reports how many fork/exit/wait cycles completed per 100
+// ticks and how often kalloc() was served from the per-CPU page
+// magazines. Run it under make qemu CPUS=1..8 with nproc = CPUS.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Fork n children, at most inflight at a time. Returns the count.
+static int
+forkloop(int n, int inflight)
+{
+  int started, live, pid;
+
+  started = live = 0;
+  while(started < n || live > 0){
+    if(started < n && live < inflight){
+      pid = fork();
+      if(pid < 0){
+        printf(2, "forkbench: fork failed after %d\n", started);
+        break;
+      }
+      if(pid == 0)
+        exit();
+      started++;
+      live++;
+      continue;
+    }
+    if(wait() < 0)
+      break;
+    live--;
+  }
+  while(live-- > 0)
+    wait();
+  return started;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct kmemstat before, after;
+  uint hits, misses;
+  int n, inflight, nproc, i, start, elapsed;
+
+  n = argc > 1 ? atoi(argv[1]) : 2000;
+  inflight = argc > 2 ? atoi(argv[2]) : 1;
+  nproc = argc > 3 ? atoi(argv[3]) : 1;
+  if(inflight < 1)
+    inflight = 1;
+  if(nproc < 1)
+    nproc = 1;
+
+  getkmemstat(&before);
+  start = uptime();
+  if(nproc == 1)
+    n = forkloop(n, inflight);
+  else {
+    for(i = 0; i < nproc; i++){
+      if(fork() == 0){
+        forkloop(n, inflight);
+        exit();
+      }
+    }
+    for(i = 0; i < nproc; i++)
+      wait();
+    n *= nproc;
+  }
+  elapsed = uptime() - start;
+  getkmemstat(&after);
+
+  hits = misses = 0;
+  for(i = 0; i < after.ncpu; i++){
+    hits += after.hits[i] - before.hits[i];
+    misses += after.misses[i] - before.misses[i];
+  }
+
+  printf(1, "forkbench: %d forks, %d in flight, %d procs, %d ticks", n, inflight, nproc, elapsed);
+  if(elapsed > 0)
+    printf(1, ", %d forks per 100 ticks", n * 100 / elapsed);
+  printf(1, "\n");
+  if(hits + misses > 0)
+    printf(1, "forkbench: kalloc magazine hits %d misses %d (%d%%)\n",
+           hits, misses, hits * 100 / (hits + misses));
+  exit();
+}
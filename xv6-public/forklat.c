@@ -0,0 +1,61 @@
+// Fork latency versus parent size.
+//   forklat [nforks]
+// Grows the heap to each size from 64 KB to 16 MB, touching every
+// page, then times nforks fork() calls whose children exit at once.
+// Reports the average TSC cycles a fork() takes in the parent, and
+// the free pages each child costs while it is alive.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+int
+main(int argc, char *argv[])
+{
+  struct kmemstat before, after;
+  uint64 t0, total;
+  uint kb, cur, want, pages;
+  char *p;
+  int n, i, pid;
+
+  n = argc > 1 ? atoi(argv[1]) : 20;
+  if(n < 1)
+    n = 1;
+
+  printf(1, "forklat: %d forks per size\n", n);
+  printf(1, "SIZE KB\tKCYCLES/FORK\tPAGES/CHILD\n");
+  cur = 0;
+  for(kb = 64; kb <= 16*1024; kb *= 4){
+    want = kb * 1024;
+    if((p = sbrk(want - cur)) == (char*)-1){
+      printf(2, "forklat: sbrk %d KB failed\n", kb);
+      break;
+    }
+    for(i = 0; i < want - cur; i += 4096)
+      p[i] = 1;
+    cur = want;
+
+    total = 0;
+    pages = 0;
+    for(i = 0; i < n; i++){
+      getkmemstat(&before);
+      t0 = rdtsc();
+      pid = fork();
+      if(pid < 0){
+        printf(2, "forklat: fork failed\n");
+        exit();
+      }
+      if(pid == 0){
+        sleep(1);
+        exit();
+      }
+      total += rdtsc() - t0;
+      getkmemstat(&after);
+      pages += before.nfree - after.nfree;
+      wait();
+    }
+    printf(1, "%d\t%d\t\t%d\n", kb, (uint)(total >> 10) / n, pages / n);
+  }
+  exit();
+}
@@ -245,15 +245,17 @@ iget(uint dev, uint inum)
 
   acquire(&icache.lock);
 
-  // Is the inode already cached?
+  // Is the inode already cached? An unreferenced entry that
+  // still has cached pages is valid and can be taken back.
   empty = 0;
   for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
-    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
+    if((ip->ref > 0 || ip->pages) && ip->dev == dev && ip->inum == inum){
       ip->ref++;
       release(&icache.lock);
       return ip;
     }
-    if(empty == 0 && ip->ref == 0)    // Remember empty slot.
+    // Remember empty slot, preferring one without cached pages.
+    if(ip->ref == 0 && (empty == 0 || (empty->pages && !ip->pages)))
       empty = ip;
   }
 
@@ -262,6 +264,7 @@ iget(uint dev, uint inum)
     panic("iget: no inodes");
 
   ip = empty;
+  pcdrop(ip);
   ip->dev = dev;
   ip->inum = inum;
   ip->ref = 1;
@@ -321,6 +324,16 @@ iunlock(struct inode *ip)
   releasesleep(&ip->lock);
 }
 
+// Add n to the count of processes running ip as their program.
+// writei() refuses to change the file while it is nonzero. The
+// count only goes from 0 to 1 in exec(), which holds ip->lock,
+// so it can't race with a writer's check.
+void
+itext(struct inode *ip, int n)
+{
+  __sync_fetch_and_add(&ip->ntext, n);
+}
+
 // Drop a reference to an in-memory inode.
 // If that was the last reference, the inode cache entry can
 // be recycled.
@@ -411,6 +424,7 @@ itrunc(struct inode *ip)
   struct buf *bp;
   uint *a;
 
+  pcdrop(ip);
   for(i = 0; i < NDIRECT; i++){
     if(ip->addrs[i]){
       bfree(ip->dev, ip->addrs[i]);
@@ -494,7 +508,12 @@ writei(struct inode *ip, char *src, uint off, uint n)
     return -1;
   if(off + n > MAXFILE*BSIZE)
     return -1;
+  // A running program reads its pages from the file on demand,
+  // so the file must not change underneath it; see itext().
+  if(ip->ntext > 0)
+    return -1;
 
+  pcdrop(ip);
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
@@ -4,13 +4,14 @@
 #include "stat.h"
 #include "user.h"
 #include "fcntl.h"
+#include "x86.h"
 
 char *argv[] = { "sh", 0 };
 
 int
 main(void)
 {
-  int pid, wpid;
+  int pid, wpid, booted;
 
   if(open("console", O_RDWR) < 0){
     mknod("console", 1, 1);
@@ -19,8 +20,15 @@ main(void)
   dup(0);  // stdout
   dup(0);  // stderr
 
+  // Millions of TSC cycles since reset, to compare time-to-shell
+  // across builds. 10^6 = 2^6 * 15625; the shift keeps the division
+  // in 32 bits, which holds for the first 2^38 cycles.
+  booted = 0;
   for(;;){
-    printf(1, "init: starting sh\n");
+    if(!booted++)
+      printf(1, "init: starting sh, %d Mcycles since boot\n", (uint)(rdtsc() >> 6) / 15625);
+    else
+      printf(1, "init: starting sh\n");
     pid = fork();
     if(pid < 0){
       printf(1, "init: fork failed\n");
@@ -1,13 +1,38 @@
 // Physical memory allocator, intended to allocate
 // memory for user processes, kernel stacks, page table pages,
-// and pipe buffers. Allocates 4096-byte pages.
+// and pipe buffers. Allocates 4096-byte pages, or naturally
+// aligned runs of 2^order pages with kallocpages().
+//
+// Free memory is managed by a binary buddy allocator: free[k]
+// holds free blocks of 2^k pages, each aligned to its size.
+// Freeing a block merges it with its buddy, the other half of
+// the enclosing 2^(k+1) block, whenever that buddy is free too.
+//
+// Each CPU also keeps a magazine of free pages that kalloc() and
+// kfree() use without taking kmem.lock. An empty magazine is
+// refilled from the buddy allocator, and a full one drained to
+// it, MAGBATCH pages at a time.
+//
+// Pages returned by kalloc() carry a reference count so that
+// copy-on-write fork can share them; kfree() drops a reference
+// and frees the page with the last one.
+//
+// kzalloc() hands out zeroed pages from a pool that idle CPUs
+// keep topped up with kzerofill(), so most callers that need a
+// clean page don't pay for the memset.
 
 #include "types.h"
 #include "defs.h"
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
+#include "kalloc.h"
+
+#define NMAG     32        // most pages a magazine holds
+#define MAGBATCH (NMAG/2)  // pages moved to or from the buddy allocator at once
+#define NZERO    256       // most pages in the zeroed pool
 
 void freerange(void *vstart, void *vend);
 extern char end[]; // first address after kernel loaded from ELF file
@@ -15,14 +40,36 @@ extern char end[]; // first address after kernel loaded from ELF file
 
 struct run {
   struct run *next;
+  struct run *prev;
 };
 
+// Only touched by its own CPU, with interrupts off.
+struct magazine {
+  struct run *freelist;
+  int n;
+  uint hits;
+  uint misses;
+  uint drains;
+} __attribute__((aligned(CACHELINE)));
+
 struct {
   struct spinlock lock;
   int use_lock;
-  struct run *freelist;
+  struct run *free[NORDER];    // Free blocks of each order
+  uint nfree[NORDER];          // Blocks on each free list
+  uchar order[PHYSTOP/PGSIZE]; // 1 + order if the page starts a free block, else 0
+  ushort ref[PHYSTOP/PGSIZE];  // References to each page from kalloc()
+  struct magazine mag[NCPU];
 } kmem;
 
+struct {
+  struct spinlock lock;
+  struct run *freelist;        // Zero-filled pages, except for the link
+  uint n;
+  uint hits;                   // kzalloc()s served from the pool
+  uint misses;                 // kzalloc()s that had to zero a page
+} kzero;
+
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
@@ -32,6 +79,7 @@ void
 kinit1(void *vstart, void *vend)
 {
   initlock(&kmem.lock, "kmem");
+  initlock(&kzero.lock, "kzero");
   kmem.use_lock = 0;
   freerange(vstart, vend);
 }
@@ -43,54 +91,336 @@ kinit2(void *vstart, void *vend)
   kmem.use_lock = 1;
 }
 
+//PAGEBREAK: 21
+// Put the block of 2^k pages at r on free[k].
+// The kmem lock must be held.
+static void
+pushblock(struct run *r, int k)
+{
+  r->prev = 0;
+  r->next = kmem.free[k];
+  if(r->next)
+    r->next->prev = r;
+  kmem.free[k] = r;
+  kmem.nfree[k]++;
+  kmem.order[V2P(r) / PGSIZE] = k + 1;
+}
+
+// Take the block at r off free[k]. The kmem lock must be held.
+static void
+unlinkblock(struct run *r, int k)
+{
+  if(r->prev)
+    r->prev->next = r->next;
+  else
+    kmem.free[k] = r->next;
+  if(r->next)
+    r->next->prev = r->prev;
+  kmem.nfree[k]--;
+  kmem.order[V2P(r) / PGSIZE] = 0;
+}
+
+// Free the block of 2^k pages at v, merging it with its buddies.
+// The kmem lock must be held.
+static void
+buddyfree(char *v, int k)
+{
+  uint pa, buddy;
+
+  pa = V2P(v);
+  for(; k < MAXORDER; k++){
+    buddy = pa ^ (PGSIZE << k);
+    if(buddy >= PHYSTOP || kmem.order[buddy / PGSIZE] != k + 1)
+      break;
+    unlinkblock((struct run*)P2V(buddy), k);
+    pa &= ~(PGSIZE << k);
+  }
+  pushblock((struct run*)P2V(pa), k);
+}
+
+// Give the pages in [vstart, vend) to the buddy allocator as the
+// largest aligned blocks that fit. Only the first page of each
+// block is written, for its free list links; the rest of memory
+// is left untouched until it is allocated.
 void
 freerange(void *vstart, void *vend)
 {
-  char *p;
-  p = (char*)PGROUNDUP((uint)vstart);
-  for(; p + PGSIZE <= (char*)vend; p += PGSIZE)
-    kfree(p);
+  uint pa, paend;
+  int k;
+
+  pa = V2P(PGROUNDUP((uint)vstart));
+  paend = V2P(vend);
+  while(pa + PGSIZE <= paend){
+    for(k = MAXORDER; k > 0; k--)
+      if(pa % (PGSIZE << k) == 0 && pa + (PGSIZE << k) <= paend)
+        break;
+    buddyfree(P2V(pa), k);
+    pa += PGSIZE << k;
+  }
 }
-//PAGEBREAK: 21
+
+// Allocate a block of 2^k pages, splitting a larger one if needed.
+// The kmem lock must be held.
+static char*
+buddyalloc(int k)
+{
+  struct run *r;
+  int j;
+
+  for(j = k; j <= MAXORDER && kmem.free[j] == 0; j++)
+    ;
+  if(j > MAXORDER)
+    return 0;
+  r = kmem.free[j];
+  unlinkblock(r, j);
+  while(j > k){
+    j--;
+    pushblock((struct run*)((char*)r + (PGSIZE << j)), j);
+  }
+  return (char*)r;
+}
+
+// Allocate 2^order physically contiguous pages, aligned to
+// their size. Returns 0 if the memory cannot be allocated.
+char*
+kallocpages(int order)
+{
+  char *v;
+
+  if(order < 0 || order > MAXORDER)
+    return 0;
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  v = buddyalloc(order);
+  if(kmem.use_lock)
+    release(&kmem.lock);
+  return v;
+}
+
+// Free 2^order pages returned by kallocpages(order).
+void
+kfreepages(char *v, int order)
+{
+  if(order < 0 || order > MAXORDER || (uint)v % (PGSIZE << order) ||
+     v < end || V2P(v) + (PGSIZE << order) > PHYSTOP)
+    panic("kfreepages");
+
+#ifdef KJUNK
+  // Fill with junk to catch dangling refs.
+  memset(v, 1, PGSIZE << order);
+#endif
+
+  if(kmem.use_lock)
+    acquire(&kmem.lock);
+  buddyfree(v, order);
+  if(kmem.use_lock)
+    release(&kmem.lock);
+}
+
 // Free the page of physical memory pointed at by v,
 // which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// call to kalloc().
 void
 kfree(char *v)
 {
+  struct magazine *m;
   struct run *r;
+  int i;
 
   if((uint)v % PGSIZE || v < end || V2P(v) >= PHYSTOP)
     panic("kfree");
+  if(kmem.ref[V2P(v) / PGSIZE] == 0)
+    panic("kfree: not allocated");
+  if(__sync_sub_and_fetch(&kmem.ref[V2P(v) / PGSIZE], 1) != 0)
+    return;
+
+  if(!kmem.use_lock){
+    // Booting: only one CPU, and mycpu() may not work yet.
+    kfreepages(v, 0);
+    return;
+  }
 
+#ifdef KJUNK
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
+#endif
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
+  pushcli();
+  m = &kmem.mag[cpuid()];
   r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  if(kmem.use_lock)
+  r->next = m->freelist;
+  m->freelist = r;
+  if(++m->n > NMAG){
+    m->drains++;
+    acquire(&kmem.lock);
+    for(i = 0; i < MAGBATCH; i++){
+      r = m->freelist;
+      m->freelist = r->next;
+      buddyfree((char*)r, 0);
+    }
     release(&kmem.lock);
+    m->n -= MAGBATCH;
+  }
+  popcli();
 }
 
 // Allocate one 4096-byte page of physical memory.
 // Returns a pointer that the kernel can use.
 // Returns 0 if the memory cannot be allocated.
+// Pages in other CPUs' magazines are not stolen, so up to
+// NCPU*NMAG free pages may be out of reach when memory is short.
 char*
 kalloc(void)
 {
+  struct magazine *m;
   struct run *r;
 
-  if(kmem.use_lock)
+  if(!kmem.use_lock){
+    if((r = (struct run*)kallocpages(0)) != 0)
+      kmem.ref[V2P(r) / PGSIZE] = 1;
+    return (char*)r;
+  }
+
+  pushcli();
+  m = &kmem.mag[cpuid()];
+  if(m->freelist)
+    m->hits++;
+  else {
+    m->misses++;
     acquire(&kmem.lock);
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  if(kmem.use_lock)
+    while(m->n < MAGBATCH && (r = (struct run*)buddyalloc(0)) != 0){
+      r->next = m->freelist;
+      m->freelist = r;
+      m->n++;
+    }
     release(&kmem.lock);
+  }
+  r = m->freelist;
+  if(r){
+    m->freelist = r->next;
+    m->n--;
+  }
+  popcli();
+  if(r == 0 && kzero.n > 0){
+    // Out of memory, but the zeroed pool still has pages.
+    acquire(&kzero.lock);
+    if((r = kzero.freelist) != 0){
+      kzero.freelist = r->next;
+      kzero.n--;
+    }
+    release(&kzero.lock);
+  }
+  if(r)
+    kmem.ref[V2P(r) / PGSIZE] = 1;
+  return (char*)r;
+}
+
+// Approximate number of free pages, not counting magazines.
+uint
+knfree(void)
+{
+  uint n;
+  int i;
+
+  n = kzero.n;
+  for(i = 0; i < NORDER; i++)
+    n += kmem.nfree[i] << i;
+  return n;
+}
+
+// Add a reference to page v, which was returned by kalloc().
+void
+krefinc(char *v)
+{
+  __sync_add_and_fetch(&kmem.ref[V2P(v) / PGSIZE], 1);
+}
+
+// Number of references to page v.
+int
+krefcnt(char *v)
+{
+  return kmem.ref[V2P(v) / PGSIZE];
+}
+
+// Allocate one zero-filled page, from the pool if it has one.
+// Returns 0 if the memory cannot be allocated.
+char*
+kzalloc(void)
+{
+  struct run *r;
+
+  r = 0;
+  if(kmem.use_lock){
+    acquire(&kzero.lock);
+    if((r = kzero.freelist) != 0){
+      kzero.freelist = r->next;
+      kzero.n--;
+      kzero.hits++;
+    } else
+      kzero.misses++;
+    release(&kzero.lock);
+  }
+  if(r){
+    r->next = 0;   // the only non-zero word
+    return (char*)r;
+  }
+  if((r = (struct run*)kalloc()) != 0)
+    memset(r, 0, PGSIZE);
   return (char*)r;
 }
 
+// Zero one page into the pool if it is not full.
+// Called by idle CPUs. Returns 1 if it did any work.
+int
+kzerofill(void)
+{
+  struct run *r;
+
+  if(!kmem.use_lock || kzero.n >= NZERO)
+    return 0;
+  if((r = (struct run*)kalloc()) == 0)
+    return 0;
+  memset(r, 0, PGSIZE);
+  acquire(&kzero.lock);
+  if(kzero.n >= NZERO){
+    release(&kzero.lock);
+    kfree((char*)r);
+    return 0;
+  }
+  r->next = kzero.freelist;
+  kzero.freelist = r;
+  kzero.n++;
+  release(&kzero.lock);
+  return 1;
+}
+
+// Snapshot allocator statistics.
+void
+getkmemstat(struct kmemstat *st)
+{
+  struct magazine *m;
+  int i;
+
+  memset(st, 0, sizeof(*st));
+  st->ncpu = ncpu;
+  acquire(&kmem.lock);
+  for(i = 0; i < NORDER; i++){
+    st->nfreeorder[i] = kmem.nfree[i];
+    st->nfree += kmem.nfree[i] << i;
+  }
+  release(&kmem.lock);
+  for(i = 0; i < ncpu; i++){
+    m = &kmem.mag[i];
+    st->cached[i] = m->n;
+    st->nfree += m->n;
+    st->hits[i] = m->hits;
+    st->misses[i] = m->misses;
+    st->drains[i] = m->drains;
+  }
+  acquire(&kzero.lock);
+  st->nzero = kzero.n;
+  st->nfree += kzero.n;
+  st->zhits = kzero.hits;
+  st->zmisses = kzero.misses;
+  release(&kzero.lock);
+}
@@ -0,0 +1,17 @@
+// Physical page allocator statistics, returned by getkmemstat().
+
+#define MAXORDER 10            // largest block is 2^MAXORDER pages (4 MB)
+#define NORDER   (MAXORDER+1)
+
+struct kmemstat {
+  int ncpu;
+  uint nfree;                  // Free pages, magazines and zeroed pool included
+  uint nfreeorder[NORDER];     // Free blocks of 2^order pages
+  uint cached[NCPU];           // Pages sitting in each CPU's magazine
+  uint hits[NCPU];             // kalloc()s served from the magazine
+  uint misses[NCPU];           // kalloc()s that refilled it from the free list
+  uint drains[NCPU];           // kfree()s that spilled it to the free list
+  uint nzero;                  // Pages in the zeroed pool
+  uint zhits;                  // kzalloc()s served from the pool
+  uint zmisses;                // kzalloc()s that had to zero a page
+};
@@ -0,0 +1,82 @@
+// Kernel spinlock scalability benchmark.
+//   lockbench [nproc] [ticks]
+// Runs nproc processes (default: one per CPU) that call uptime()
+// in a loop for the given number of ticks. Each call takes
+// tickslock, so they all contend for the same kernel lock. Reports
+// the total calls per tick, the spread between the fastest and
+// slowest process, and the slowest single call in TSC cycles.
+// Run it under make qemu CPUS=1, 2, 4 and 8 to compare.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+struct result {
+  uint calls;
+  uint maxcycles;
+};
+
+int
+main(int argc, char *argv[])
+{
+  struct sysstat st;
+  struct result r, sum;
+  uint minc, maxc;
+  uint64 t0, dt;
+  int nproc, duration, start, i, fd[2];
+
+  getsysstat(&st);
+  nproc = argc > 1 ? atoi(argv[1]) : st.ncpu;
+  duration = argc > 2 ? atoi(argv[2]) : 200;
+  if(nproc < 1)
+    nproc = 1;
+  if(duration < 1)
+    duration = 1;
+  if(pipe(fd) < 0){
+    printf(2, "lockbench: pipe failed\n");
+    exit();
+  }
+
+  start = uptime() + 1;
+  for(i = 0; i < nproc; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      r.calls = r.maxcycles = 0;
+      while(uptime() < start)
+        ;
+      for(;;){
+        t0 = rdtsc();
+        if(uptime() >= start + duration)
+          break;
+        dt = rdtsc() - t0;
+        r.calls++;
+        if((dt >> 32) == 0 && dt > r.maxcycles)
+          r.maxcycles = dt;
+      }
+      write(fd[1], &r, sizeof(r));
+      exit();
+    }
+  }
+  close(fd[1]);
+
+  sum.calls = sum.maxcycles = 0;
+  minc = 0xffffffff;
+  maxc = 0;
+  for(i = 0; i < nproc && read(fd[0], &r, sizeof(r)) == sizeof(r); i++){
+    sum.calls += r.calls;
+    if(r.maxcycles > sum.maxcycles)
+      sum.maxcycles = r.maxcycles;
+    if(r.calls < minc)
+      minc = r.calls;
+    if(r.calls > maxc)
+      maxc = r.calls;
+  }
+  while(wait() >= 0)
+    ;
+
+  printf(1, "lockbench: %d cpus %d procs %d ticks\n", st.ncpu, nproc, duration);
+  printf(1, "  %d acquires per tick, per proc %d..%d, max %d cycles\n",
+         sum.calls / duration, minc, maxc, sum.maxcycles);
+  exit();
+}
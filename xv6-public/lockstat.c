@@ -0,0 +1,48 @@
+// Print kernel spinlock statistics.
+//   lockstat [-s]
+// One line per lock name: how many times a lock of that name was
+// initialized since boot, acquires, contended acquires, average and
+// worst wait and hold times in TSC cycles. -s also lists the most
+// contended call sites; look them up with addr2line -e kernel.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// a / b for 64-bit a without 64-bit division.
+static uint
+avg(uint64 a, uint b)
+{
+  if(b == 0)
+    return 0;
+  if(a >> 32)
+    return ((uint)(a >> 10) / b) << 10;
+  return (uint)a / b;
+}
+
+int
+main(int argc, char *argv[])
+{
+  static struct lockstat ls[NLOCKCLASS];
+  int i, j, n, sites;
+
+  sites = argc > 1 && strcmp(argv[1], "-s") == 0;
+  n = getlockstat(ls, NLOCKCLASS);
+  if(n < 0){
+    printf(2, "lockstat: kernel built without LOCKSTAT\n");
+    exit();
+  }
+  printf(1, "NAME\t\tINITS\tACQ\tCONT\tSPIN\tSPINMAX\tHOLD\tHOLDMAX\n");
+  for(i = 0; i < n; i++){
+    printf(1, "%s\t%s%d\t%d\t%d\t%d\t%d\t%d\t%d\n", ls[i].name,
+           strlen(ls[i].name) < 8 ? "\t" : "", ls[i].ninit,
+           ls[i].acquires, ls[i].contended,
+           avg(ls[i].spin_total, ls[i].contended), ls[i].spin_max,
+           avg(ls[i].hold_total, ls[i].acquires), ls[i].hold_max);
+    if(!sites)
+      continue;
+    for(j = 0; j < NLOCKSITE && ls[i].sitecount[j]; j++)
+      printf(1, "\t%x\t%d contended\n", ls[i].sitepc[j], ls[i].sitecount[j]);
+  }
+  exit();
+}
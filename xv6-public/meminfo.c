@@ -0,0 +1,34 @@
+// Print physical page allocator statistics: free memory, free
+// blocks of each buddy order, and per-CPU magazine counters.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int
+main(void)
+{
+  struct kmemstat st;
+  int i;
+
+  if(getkmemstat(&st) < 0){
+    printf(2, "meminfo: getkmemstat failed\n");
+    exit();
+  }
+  printf(1, "free: %d pages (%d KB)\n", st.nfree, st.nfree * 4);
+  printf(1, "zeroed pool: %d pages, %d hits, %d misses", st.nzero, st.zhits, st.zmisses);
+  if(st.zhits + st.zmisses > 0)
+    printf(1, " (%d%%)", st.zhits * 100 / (st.zhits + st.zmisses));
+  printf(1, "\n");
+  printf(1, "order:");
+  for(i = 0; i < 11; i++)
+    printf(1, "\t%d", i);
+  printf(1, "\nblocks:");
+  for(i = 0; i < 11; i++)
+    printf(1, "\t%d", st.nfreeorder[i]);
+  printf(1, "\n\nCPU\tCACHED\tHITS\tMISSES\tDRAINS\n");
+  for(i = 0; i < st.ncpu; i++)
+    printf(1, "%d\t%d\t%d\t%d\t%d\n", i, st.cached[i], st.hits[i],
+           st.misses[i], st.drains[i]);
+  exit();
+}
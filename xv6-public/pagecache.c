@@ -0,0 +1,90 @@
+// Page cache for executables.
+//
+// pagefault() reads the file-backed pages of a program through
+// here, so every process running the same binary maps the same
+// physical pages, read-only and copy-on-write. Pages that are
+// never written, such as the text, stay shared; a write gives the
+// process its own copy as for a forked page.
+//
+// Each inode keeps a list of its cached pages, protected by the
+// inode's sleep lock. The list holds one reference to each page
+// and every mapping holds another, so a page is freed once it is
+// both dropped from the cache and unmapped everywhere. writei()
+// refuses to change a file some process is running, see itext();
+// once none is, writing or truncating the file drops its pages.
+// The pages of an inode nobody holds
+// stay cached until iget() recycles its slot, so launching the same
+// program again finds them.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "file.h"
+
+struct cpage {
+  uint off;             // File offset of the page's contents
+  uint n;               // Bytes from the file; the rest is zero
+  char *mem;
+  struct cpage *next;   // Next page of the same inode
+};
+
+static struct kcache *cpagecache;
+
+void
+pcinit(void)
+{
+  cpagecache = kcachecreate("pagecache", sizeof(struct cpage));
+}
+
+// Return a page holding the n bytes of ip at off followed by
+// zeros, with a reference for the caller. Caller holds ip->lock.
+char*
+pcget(struct inode *ip, uint off, uint n)
+{
+  struct cpage *c;
+  char *mem;
+
+  for(c = ip->pages; c; c = c->next){
+    if(c->off == off && c->n == n){
+      krefinc(c->mem);
+      return c->mem;
+    }
+  }
+
+  if((mem = kalloc()) == 0)
+    return 0;
+  if(readi(ip, mem, off, n) != n){
+    kfree(mem);
+    return 0;
+  }
+  memset(mem + n, 0, PGSIZE - n);
+
+  // Out of memory for the entry: the caller gets a private page.
+  if((c = (struct cpage*)kcachealloc(cpagecache)) == 0)
+    return mem;
+  c->off = off;
+  c->n = n;
+  c->mem = mem;
+  c->next = ip->pages;
+  ip->pages = c;
+  krefinc(mem);
+  return mem;
+}
+
+// Drop the cached pages of ip. Caller holds ip->lock, or
+// icache.lock when ip has no references.
+void
+pcdrop(struct inode *ip)
+{
+  struct cpage *c;
+
+  while((c = ip->pages) != 0){
+    ip->pages = c->next;
+    kfree(c->mem);
+    kcachefree(cpagecache, c);
+  }
+}
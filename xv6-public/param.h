@@ -1,5 +1,7 @@
 #define NPROC        64  // maximum number of processes
+#define MAXPID    32768  // pids are handed out below this, then wrap
 #define KSTACKSIZE 4096  // size of per-process kernel stack
+#define CACHELINE    64  // bytes in an x86 cache line
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
@@ -7,8 +9,10 @@
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
+#define MAXSEG        4  // program segments exec leaves to pagefault()
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       3000  // size of file system in blocks
+#define TICKUS      10000  // nominal timer tick length in microseconds
 
@@ -6,10 +6,27 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "trace.h"
+
+#define NPIDHASH 64  // pid hash buckets, a power of two
+#define NSLEEPQBITS 6
+#define NSLEEPQ  (1<<NSLEEPQBITS)  // sleep queue buckets
+
+// Processes sleeping on channels that hash to the same bucket,
+// oldest first.
+struct sleepq {
+  struct proc *head;
+  struct proc *tail;
+};
 
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
+  struct proc *pidhash[NPIDHASH];  // Allocated procs chained by pid
+  struct proc *freelist;           // UNUSED slots, most recently freed first
+  struct sleepq sleepq[NSLEEPQ];   // SLEEPING procs chained by chan
+  struct session sess[NPROC];
+  uint sessfloor;               // vruntime of the last session picked
 } ptable;
 
 static struct proc *initproc;
@@ -25,11 +42,19 @@ void fixdelete(struct rbtree* tree, struct proc* parentProc, struct proc* p);
 // static int latency = NPROC / 2; // Default period of the scheduler
 // static int min_granularity = 2; // 2 CPU ticks
 
+// Autogroup charging. Each tick a process runs charges its session
+// SESS_SLICE scaled by 1024/weight; a session coming back from idle
+// keeps at most SESS_CREDIT of banked time over the busiest sessions.
+#define SESS_SLICE  1024
+#define SESS_CREDIT (4*SESS_SLICE)
+
 int nextpid = 1;
+static int pidwrapped;  // nextpid has wrapped, so pids may be taken
 extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static void updateload(struct proc *p);
 
 // Must be called with interrupts disabled
 int
@@ -37,39 +62,6 @@ cpuid() {
   return mycpu()-cpus;
 }
 
-// Must be called with interrupts disabled to avoid the caller being
-// rescheduled between reading lapicid and running through the loop.
-struct cpu*
-mycpu(void)
-{
-  int apicid, i;
-  
-  if(readeflags()&FL_IF)
-    panic("mycpu called with interrupts enabled\n");
-  
-  apicid = lapicid();
-  // APIC IDs are not guaranteed to be contiguous. Maybe we should have
-  // a reverse map, or reserve a register to store &cpus[i].
-  for (i = 0; i < ncpu; ++i) {
-    if (cpus[i].apicid == apicid)
-      return &cpus[i];
-  }
-  panic("unknown apicid\n");
-}
-
-// Disable interrupts so that we are not rescheduled
-// while reading proc from the cpu structure
-struct proc*
-myproc(void) {
-  struct cpu *c;
-  struct proc *p;
-  pushcli();
-  c = mycpu();
-  p = c->proc;
-  popcli();
-  return p;
-}
-
 struct rbtree* gettree(void){
   return runnable_tasks;
 }
@@ -82,26 +74,100 @@ gettreeinfo(int *count, int *total_weight, int *period)
   *period = runnable_tasks->period;
 }
 
+// Look up an allocated process by pid in the pid hash.
+// Returns 0 if there is none. The ptable lock must be held.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = ptable.pidhash[pid & (NPIDHASH-1)]; p != 0; p = p->pidnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// Add p, whose pid is set, to the pid hash.
+// The ptable lock must be held.
+static void
+hashpid(struct proc *p)
+{
+  struct proc **pp = &ptable.pidhash[p->pid & (NPIDHASH-1)];
+
+  p->pidnext = *pp;
+  *pp = p;
+}
+
+// Remove p from the pid hash. The ptable lock must be held.
+static void
+unhashpid(struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = &ptable.pidhash[p->pid & (NPIDHASH-1)]; *pp != 0; pp = &(*pp)->pidnext){
+    if(*pp == p){
+      *pp = p->pidnext;
+      p->pidnext = 0;
+      return;
+    }
+  }
+  panic("unhashpid");
+}
+
 void
 getprocinfo(int pid, struct proc_info *info)
 {
   struct proc *p;
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      info->pid = p->pid;
-      info->nice_value = p->nice_value;
-      info->weight = p->weight;
-      info->vruntime = p->vruntime;
-      info->curr_runtime = p->curr_runtime;
-      release(&ptable.lock);
-      return;
-    }
+  if((p = findproc(pid)) != 0){
+    info->pid = p->pid;
+    info->nice_value = p->nice_value;
+    info->weight = p->weight;
+    info->vruntime = p->vruntime;
+    info->curr_runtime = p->curr_runtime;
+    updateload(p);
+    info->util_avg = p->util_avg;
+    info->runnable_avg = p->runnable_avg;
+    info->load_avg = p->load_avg;
+    release(&ptable.lock);
+    return;
   }
   release(&ptable.lock);
   info->pid = -1;
 }
 
+// getprocs() hands out enum procstate values, which user.h
+// names PROC_EMBRYO .. PROC_ZOMBIE; fail to build if they drift.
+typedef char procstate_abi[EMBRYO == 1 && SLEEPING == 2 && RUNNABLE == 3 &&
+                           RUNNING == 4 && ZOMBIE == 5 ? 1 : -1];
+
+// Fill buf with up to max live processes, taken in one pass under
+// ptable.lock so the snapshot is consistent. Returns the count.
+int
+getprocs(struct proc_snapshot *buf, int max)
+{
+  struct proc *p;
+  int n = 0;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && n < max; p++){
+    if(p->state == UNUSED)
+      continue;
+    buf[n].pid = p->pid;
+    buf[n].state = p->state;
+    safestrcpy(buf[n].name, p->name, sizeof(buf[n].name));
+    buf[n].nice_value = p->nice_value;
+    buf[n].weight = p->weight;
+    buf[n].vruntime = p->vruntime;
+    buf[n].runtime = p->run_ticks;
+    if(p->state == RUNNING)
+      buf[n].runtime += ticks - p->state_since;
+    buf[n].cpu = p->lastcpu;
+    n++;
+  }
+  release(&ptable.lock);
+  return n;
+}
 
 int check_rb_tree_properties(struct proc *node, int black_count, int *path_black_count);
 
@@ -196,6 +262,310 @@ compute_weight(int nice_value)
   }
 }
 
+// Per-entity load tracking (PELT).
+// Each signal is a geometric average over past ticks with decay
+// y per tick, y^32 = 1/2, so a tick's contribution halves every 32
+// ticks. pelt_y[i] is y^i in 16.16 fixed point.
+static uint pelt_y[32] = {
+  65536, 64132, 62757, 61413, 60097, 58809, 57549, 56316,
+  55109, 53928, 52773, 51642, 50535, 49452, 48393, 47356,
+  46341, 45348, 44376, 43425, 42495, 41584, 40693, 39821,
+  38968, 38133, 37316, 36516, 35734, 34968, 34219, 33486,
+};
+
+// Return val * y^n.
+static uint
+pelt_decay(uint val, uint n)
+{
+  if(n >= 32*32)
+    return 0;
+  val >>= n / 32;
+  return ((uint64)val * pelt_y[n % 32]) >> 16;
+}
+
+// Advance avg from tick last to now, assuming the tracked quantity
+// was contrib throughout. Since the series is geometric this is
+// avg*y^n + contrib*(1 - y^n).
+static uint
+pelt_avg(uint avg, uint contrib, uint last)
+{
+  uint n = ticks - last;
+
+  return pelt_decay(avg, n) + contrib - pelt_decay(contrib, n);
+}
+
+// Bring p's signals up to date for the state it has been in since
+// its last update. The ptable lock must be held.
+static void
+updateload(struct proc *p)
+{
+  int running = p->state == RUNNING;
+  int runnable = running || p->state == RUNNABLE;
+
+  p->util_avg = pelt_avg(p->util_avg, running ? 1024 : 0, p->pelt_last);
+  p->runnable_avg = pelt_avg(p->runnable_avg, runnable ? 1024 : 0, p->pelt_last);
+  p->load_avg = p->runnable_avg * p->weight / 1024;
+  p->pelt_last = ticks;
+}
+
+// Change the run queue's runnable weight by delta, first folding
+// the time spent at the old weight into its load average.
+// The ptable lock must be held.
+static void
+updaterqload(int delta)
+{
+  runnable_tasks->load_avg = pelt_avg(runnable_tasks->load_avg,
+    runnable_tasks->runnable_weight, runnable_tasks->pelt_last);
+  runnable_tasks->pelt_last = ticks;
+  runnable_tasks->runnable_weight += delta;
+}
+
+// Close the interval p has spent in its current state
+// into its schedstats. The ptable lock must be held.
+static void
+updatestats(struct proc *p)
+{
+  uint delta = ticks - p->state_since;
+  int slice = p->time_slice > 0 ? p->time_slice : 1;
+
+  if(p->state == RUNNING){
+    p->run_ticks += delta;
+    if(delta > slice)
+      p->noverruns++;
+  } else if(p->state == RUNNABLE){
+    p->wait_ticks += delta;
+    if(delta > p->max_wait)
+      p->max_wait = delta;
+  }
+  p->state_since = ticks;
+}
+
+// Wakeup-to-run latency histograms, protected by ptable.lock.
+static struct {
+  uint hist[NCPU][NLATBUCKET];
+  uint max_us[NCPU];
+} lat;
+
+// p is being switched in: record how long it sat RUNNABLE
+// in this CPU's histogram. The ptable lock must be held.
+static void
+recordlatency(struct proc *p)
+{
+  uint64 cycles = rdtsc() - p->runnable_tsc;
+  uint tscperus = tscpertick / TICKUS;
+  uint us;
+  int b, cpu;
+
+  if(tscperus == 0)
+    return;  // TSC not calibrated yet
+  us = (cycles >> 32) ? 0xffffffff / tscperus : (uint)cycles / tscperus;
+  for(b = 0; b < NLATBUCKET-1 && (us >> (b+1)) != 0; b++)
+    ;
+  cpu = cpuid();
+  lat.hist[cpu][b]++;
+  if(us > lat.max_us[cpu])
+    lat.max_us[cpu] = us;
+  if(us > p->max_latency)
+    p->max_latency = us;
+}
+
+// Snapshot the latency histograms, clearing them if reset.
+void
+getlatency(struct latstat *ls, int reset)
+{
+  acquire(&ptable.lock);
+  ls->ncpu = ncpu;
+  memmove(ls->hist, lat.hist, sizeof(ls->hist));
+  memmove(ls->max_us, lat.max_us, sizeof(ls->max_us));
+  if(reset)
+    memset(&lat, 0, sizeof(lat));
+  release(&ptable.lock);
+}
+
+// Sleep queue bucket for chan. Channels are mostly addresses of
+// nearby fields, so hash multiplicatively and keep the top bits.
+static struct sleepq*
+sleepqueue(void *chan)
+{
+  return &ptable.sleepq[((uint)chan * 2654435761U) >> (32 - NSLEEPQBITS)];
+}
+
+// Append p to the sleep queue of p->chan.
+// The ptable lock must be held.
+static void
+sleepenq(struct proc *p)
+{
+  struct sleepq *q = sleepqueue(p->chan);
+
+  p->sleepnext = 0;
+  p->sleepprev = q->tail;
+  if(q->tail)
+    q->tail->sleepnext = p;
+  else
+    q->head = p;
+  q->tail = p;
+}
+
+// Remove p from the sleep queue of p->chan.
+// The ptable lock must be held.
+static void
+sleepdeq(struct proc *p)
+{
+  struct sleepq *q = sleepqueue(p->chan);
+
+  if(p->sleepprev)
+    p->sleepprev->sleepnext = p->sleepnext;
+  else
+    q->head = p->sleepnext;
+  if(p->sleepnext)
+    p->sleepnext->sleepprev = p->sleepprev;
+  else
+    q->tail = p->sleepprev;
+  p->sleepnext = p->sleepprev = 0;
+}
+
+// Move p to state s. Every scheduling state change goes through
+// here so load tracking and schedstats see each enqueue, dequeue
+// and switch. The ptable lock must be held.
+static void
+setstate(struct proc *p, enum procstate s)
+{
+  int was = p->state == RUNNABLE || p->state == RUNNING;
+  int is = s == RUNNABLE || s == RUNNING;
+
+  updateload(p);
+  updatestats(p);
+  if(p->state == SLEEPING && s == RUNNABLE)
+    trace(TRACE_WAKEUP, p, myproc(), 0);
+  if(s == RUNNABLE)
+    p->runnable_tsc = rdtsc();
+  else if(p->state == RUNNABLE && s == RUNNING)
+    recordlatency(p);
+  if(was && !is){
+    updaterqload(-p->weight);
+    runnable_tasks->nr_running--;
+  } else if(is && !was){
+    updaterqload(p->weight);
+    runnable_tasks->nr_running++;
+  }
+  if(p->state == SLEEPING)
+    sleepdeq(p);
+  else if(s == SLEEPING)
+    sleepenq(p);
+  p->state = s;
+}
+
+// Report the utilization of CPU cpu and the run queue load.
+int
+getcpuload(int cpu, struct cpu_load *cl)
+{
+  struct cpu *c;
+
+  if(cpu < 0 || cpu >= ncpu)
+    return -1;
+  c = &cpus[cpu];
+
+  acquire(&ptable.lock);
+  cl->util_avg = pelt_avg(c->util_avg, c->proc ? 1024 : 0, c->pelt_last);
+  cl->rq_load_avg = pelt_avg(runnable_tasks->load_avg,
+    runnable_tasks->runnable_weight, runnable_tasks->pelt_last);
+  cl->rq_runnable_weight = runnable_tasks->runnable_weight;
+  release(&ptable.lock);
+  return 0;
+}
+
+// Load averages, sampled every LOAD_FREQ ticks (about 5 seconds)
+// from the number of runnable processes. EXP_n is e^(-5s/n min)
+// in LOAD_FSHIFT fixed point, as in the classic Unix loadavg.
+#define LOAD_FREQ 500
+#define FIXED_1   (1<<LOAD_FSHIFT)
+#define EXP_1     1884
+#define EXP_5     2014
+#define EXP_15    2037
+
+static uint loadavg[3];
+
+static uint
+calcload1(uint load, uint exp, uint n)
+{
+  return (load * exp + n * (FIXED_1 - exp)) >> LOAD_FSHIFT;
+}
+
+// Fold the current runnable count into the load averages.
+// Called from the timer interrupt with tickslock held.
+void
+calcload(void)
+{
+  uint n;
+
+  if(ticks % LOAD_FREQ != 0)
+    return;
+  n = runnable_tasks->nr_running * FIXED_1;
+  loadavg[0] = calcload1(loadavg[0], EXP_1, n);
+  loadavg[1] = calcload1(loadavg[1], EXP_5, n);
+  loadavg[2] = calcload1(loadavg[2], EXP_15, n);
+}
+
+// Snapshot uptime, load averages and per-CPU time accounting.
+void
+getsysstat(struct sysstat *st)
+{
+  int i, j;
+
+  acquire(&tickslock);
+  st->uptime = ticks;
+  for(i = 0; i < 3; i++)
+    st->loadavg[i] = loadavg[i];
+  release(&tickslock);
+
+  st->nrunning = runnable_tasks->nr_running;
+  st->ncpu = ncpu;
+  memset(st->cpu, 0, sizeof(st->cpu));
+  for(i = 0; i < ncpu; i++)
+    for(j = 0; j < NCPUSTAT; j++)
+      st->cpu[i][j] = cpus[i].stat[j];
+}
+
+// Report the schedstats of process pid, including the part
+// of its current state that has elapsed so far. The interval
+// stays open, so reading doesn't split a long run or wait.
+int
+getschedstat(int pid, struct schedstat *st)
+{
+  struct proc *p;
+  uint delta;
+  int slice;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) != 0){
+    st->version = SCHEDSTAT_VERSION;
+    st->pid = p->pid;
+    st->run_ticks = p->run_ticks;
+    st->wait_ticks = p->wait_ticks;
+    st->max_wait = p->max_wait;
+    st->nvcsw = p->nvcsw;
+    st->nivcsw = p->nivcsw;
+    st->nmigrations = p->nmigrations;
+    st->noverruns = p->noverruns;
+    st->max_latency = p->max_latency;
+    delta = ticks - p->state_since;
+    slice = p->time_slice > 0 ? p->time_slice : 1;
+    if(p->state == RUNNING){
+      st->run_ticks += delta;
+      if(delta > slice)
+        st->noverruns++;
+    } else if(p->state == RUNNABLE){
+      st->wait_ticks += delta;
+      if(delta > st->max_wait)
+        st->max_wait = delta;
+    }
+    release(&ptable.lock);
+    return 0;
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
 // setnice(int pid, int nice_value)
 // This function sets the nice value for a process identified by its PID.
 // Recalculate the weight of the process after setting the nice value.
@@ -214,20 +584,23 @@ int setnice(int pid, int nice_value)
   // Acquire the process table lock
   acquire(&ptable.lock);
 
-  // Loop through the process table to find the process with the given PID
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      // Set the new nice value
-      p->nice_value = nice_value;
+  // Look up the process with the given PID
+  if((p = findproc(pid)) != 0){
+    // Set the new nice value
+    p->nice_value = nice_value;
 
-      // Recalculate the weight based on the new nice value
-      p->weight = compute_weight(p->nice_value);
+    // Recalculate the weight based on the new nice value,
+    // keeping the run queue's runnable weight in step.
+    updateload(p);
+    if(p->state == RUNNABLE || p->state == RUNNING)
+      updaterqload(compute_weight(p->nice_value) - p->weight);
+    p->weight = compute_weight(p->nice_value);
+    trace(TRACE_NICE, p, 0, nice_value);
 
-      // Release the lock and return success
-      release(&ptable.lock);
-      return 0;
-      }
-    }
+    // Release the lock and return success
+    release(&ptable.lock);
+    return 0;
+  }
 
   // Release the lock if process not found
   release(&ptable.lock);
@@ -247,6 +620,8 @@ void treeinit(struct rbtree *tree, char *lockName)
   tree->length = 0;
   tree->total_weight = 0;
   tree->period = NPROC / 2;
+  tree->next = 0;
+  tree->skip = 0;
 }
 
 // full(struct rbtree *tree)
@@ -620,15 +995,167 @@ should_preempt(struct proc* current, struct proc* min_vruntime){
   return min_vruntime != 0 && (current->curr_runtime >= current->time_slice || current->vruntime > min_vruntime->vruntime);
 }
 
+// Set up a new session led by sid with one member.
+// The ptable lock must be held.
+static struct session*
+allocsession(int sid)
+{
+  struct session *s;
+
+  for(s = ptable.sess; s < &ptable.sess[NPROC]; s++){
+    if(s->sid != 0)
+      continue;
+    s->sid = sid;
+    s->nproc = 1;
+    s->nice_value = 0;
+    s->weight = compute_weight(s->nice_value);
+    s->vruntime = ptable.sessfloor;
+    s->last = 0;
+    return s;
+  }
+  panic("allocsession");
+}
+
+// Drop one member from s; the last one out frees it.
+// The ptable lock must be held.
+static void
+putsession(struct session *s)
+{
+  if(--s->nproc == 0)
+    s->sid = 0;
+}
+
+// Start a new session led by the caller, leaving the old one.
+// Returns the new session ID, or -1 if the caller already
+// leads its session.
+int
+setsid(void)
+{
+  struct proc *curproc = myproc();
+
+  acquire(&ptable.lock);
+  if(curproc->session->sid == curproc->pid){
+    release(&ptable.lock);
+    return -1;
+  }
+  putsession(curproc->session);
+  curproc->session = allocsession(curproc->pid);
+  release(&ptable.lock);
+  return curproc->pid;
+}
+
+// Set the nice value of session sid, which scales the CPU share of
+// the whole group against other sessions. Clamped like setnice().
+int
+setsessnice(int sid, int nice_value)
+{
+  struct session *s;
+
+  if(nice_value < -20)
+    nice_value = -20;
+  if(nice_value > 19)
+    nice_value = 19;
+
+  acquire(&ptable.lock);
+  for(s = ptable.sess; s < &ptable.sess[NPROC]; s++){
+    if(s->sid == sid){
+      s->nice_value = nice_value;
+      s->weight = compute_weight(nice_value);
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  return -1;
+}
+
+// Add p to the front of the sibling list at *head.
+// The ptable lock must be held.
+static void
+linkchild(struct proc **head, struct proc *p)
+{
+  p->sibprev = 0;
+  p->sibnext = *head;
+  if(*head)
+    (*head)->sibprev = p;
+  *head = p;
+}
+
+// Remove p from the sibling list at *head.
+// The ptable lock must be held.
+static void
+unlinkchild(struct proc **head, struct proc *p)
+{
+  if(p->sibprev)
+    p->sibprev->sibnext = p->sibnext;
+  else
+    *head = p->sibnext;
+  if(p->sibnext)
+    p->sibnext->sibprev = p->sibprev;
+  p->sibnext = p->sibprev = 0;
+}
+
+// Return slot p to the free list as UNUSED.
+// The ptable lock must be held.
+static void
+freeslot(struct proc *p)
+{
+  setstate(p, UNUSED);
+  p->freenext = ptable.freelist;
+  ptable.freelist = p;
+}
+
 void
 pinit(void)
 {
+  struct proc *p;
+
   initlock(&ptable.lock, "ptable");
   treeinit(runnable_tasks, "runnable_tasks");
+
+  // Every slot starts free; push in reverse so proc[0] goes first.
+  for(p = &ptable.proc[NPROC-1]; p >= ptable.proc; p--){
+    p->freenext = ptable.freelist;
+    ptable.freelist = p;
+  }
+}
+
+// Is pid taken by a live process or as the ID of a live session?
+// The ptable lock must be held.
+static int
+pidinuse(int pid)
+{
+  struct session *s;
+
+  if(findproc(pid) != 0)
+    return 1;
+  for(s = ptable.sess; s < &ptable.sess[NPROC]; s++)
+    if(s->sid == pid)
+      return 1;
+  return 0;
+}
+
+// Hand out the next free pid, wrapping at MAXPID. Until the first
+// wrap every pid is fresh; after it, skip pids still in use.
+// The ptable lock must be held.
+static int
+allocpid(void)
+{
+  int pid;
+
+  for(;;){
+    pid = nextpid++;
+    if(nextpid >= MAXPID){
+      nextpid = 1;
+      pidwrapped = 1;
+    }
+    if(!pidwrapped || !pidinuse(pid))
+      return pid;
+  }
 }
 
 //PAGEBREAK: 32
-// Look in the process table for an UNUSED proc.
+// Take an UNUSED proc off the free list.
 // If found, change state to EMBRYO and initialize
 // state required to run in the kernel.
 // Otherwise return 0.
@@ -640,22 +1167,27 @@ allocproc(void)
 
   acquire(&ptable.lock);
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-
-  release(&ptable.lock);
-  return 0;
+  if((p = ptable.freelist) == 0){
+    release(&ptable.lock);
+    return 0;
+  }
+  ptable.freelist = p->freenext;
+  p->freenext = 0;
+  p->children = 0;
+  p->zombies = 0;
 
-found:
   p->state = EMBRYO;
-  p->pid = nextpid++;
+  p->pid = allocpid();
+  hashpid(p);
 
   release(&ptable.lock);
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    acquire(&ptable.lock);
+    unhashpid(p);
+    freeslot(p);
+    release(&ptable.lock);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -681,6 +1213,24 @@ found:
   p->nice_value = 0;
   p->weight = compute_weight(p->nice_value);
 
+  // Start load tracking from an idle history.
+  p->pelt_last = ticks;
+  p->util_avg = 0;
+  p->runnable_avg = 0;
+  p->load_avg = 0;
+
+  // Start schedstats from zero.
+  p->state_since = ticks;
+  p->lastcpu = -1;
+  p->run_ticks = 0;
+  p->wait_ticks = 0;
+  p->max_wait = 0;
+  p->nvcsw = 0;
+  p->nivcsw = 0;
+  p->nmigrations = 0;
+  p->noverruns = 0;
+  p->max_latency = 0;
+
   // Initialize red-black tree members of the process
   p->l = 0;
   p->r = 0;
@@ -722,7 +1272,8 @@ userinit(void)
   // because the assignment might not be atomic.
   acquire(&ptable.lock);
 
-  p->state = RUNNABLE;
+  p->session = allocsession(p->pid);
+  setstate(p, RUNNABLE);
 
   release(&ptable.lock);
 }
@@ -733,15 +1284,27 @@ int
 growproc(int n)
 {
   uint sz;
+  struct segment *s;
   struct proc *curproc = myproc();
 
   sz = curproc->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    // Only reserve the address space; pagefault() allocates
+    // each page on first touch. Refuse to promise more pages
+    // than are free now.
+    if(sz + n >= KERNBASE || sz + n < sz || n / PGSIZE > knfree())
       return -1;
+    sz += n;
   } else if(n < 0){
     if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
       return -1;
+    // Pages given back must not be read in from the file again.
+    for(s = curproc->seg; s < &curproc->seg[curproc->nseg]; s++){
+      if(s->va + s->memsz > sz)
+        s->memsz = sz > s->va ? sz - s->va : 0;
+      if(s->filesz > s->memsz)
+        s->filesz = s->memsz;
+    }
   }
   curproc->sz = sz;
   switchuvm(curproc);
@@ -767,11 +1330,13 @@ fork(void)
   if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
-    np->state = UNUSED;
+    acquire(&ptable.lock);
+    unhashpid(np);
+    freeslot(np);
+    release(&ptable.lock);
     return -1;
   }
   np->sz = curproc->sz;
-  np->parent = curproc;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -781,6 +1346,12 @@ fork(void)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
+  if(curproc->exe){
+    np->exe = idup(curproc->exe);
+    itext(np->exe, 1);
+  }
+  np->nseg = curproc->nseg;
+  memmove(np->seg, curproc->seg, sizeof(np->seg));
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
@@ -788,7 +1359,12 @@ fork(void)
 
   acquire(&ptable.lock);
 
-  np->state = RUNNABLE;
+  np->parent = curproc;
+  linkchild(&curproc->children, np);
+  np->session = curproc->session;
+  np->session->nproc++;
+  trace(TRACE_FORK, np, curproc, 0);
+  setstate(np, RUNNABLE);
 
   release(&ptable.lock);
 
@@ -818,8 +1394,14 @@ exit(void)
 
   begin_op();
   iput(curproc->cwd);
+  if(curproc->exe){
+    itext(curproc->exe, -1);
+    iput(curproc->exe);
+  }
   end_op();
   curproc->cwd = 0;
+  curproc->exe = 0;
+  curproc->nseg = 0;
 
   acquire(&ptable.lock);
 
@@ -827,16 +1409,33 @@ exit(void)
   wakeup1(curproc->parent);
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == curproc){
+  while((p = curproc->children) != 0){
+    unlinkchild(&curproc->children, p);
+    p->parent = initproc;
+    linkchild(&initproc->children, p);
+  }
+  if(curproc->zombies != 0){
+    while((p = curproc->zombies) != 0){
+      unlinkchild(&curproc->zombies, p);
       p->parent = initproc;
-      if(p->state == ZOMBIE)
-        wakeup1(initproc);
+      linkchild(&initproc->zombies, p);
     }
+    wakeup1(initproc);
   }
 
+  // Move to the parent's list of children to reap.
+  unlinkchild(&curproc->parent->children, curproc);
+  linkchild(&curproc->parent->zombies, curproc);
+
+  // Drop any buddy hints that still name us.
+  if(runnable_tasks->next == curproc)
+    runnable_tasks->next = 0;
+  if(runnable_tasks->skip == curproc)
+    runnable_tasks->skip = 0;
+
   // Jump into the scheduler, never to return.
-  curproc->state = ZOMBIE;
+  trace(TRACE_EXIT, curproc, 0, 0);
+  setstate(curproc, ZOMBIE);
   sched();
   panic("zombie exit");
 }
@@ -846,39 +1445,62 @@ exit(void)
 int
 wait(void)
 {
-  struct proc *p;
-  int havekids, pid;
+  return waitpid(-1, 0, 0);
+}
+
+// Wait for child pid, or any child if pid is -1, to exit and
+// return its pid. If status is non-zero, store 1 there if the
+// child was killed and 0 otherwise. With WNOHANG, return 0
+// rather than block if the child is still running. Return -1 if
+// there is no such child.
+int
+waitpid(int pid, int *status, int options)
+{
+  struct proc *p, *q;
+  int havekids;
   struct proc *curproc = myproc();
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for zombie children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
-      havekids = 1;
-      if(p->state == ZOMBIE){
-        // Found one.
-        pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
-        release(&ptable.lock);
-        return pid;
-      }
+    // Look through the children that have already exited.
+    for(p = curproc->zombies; p != 0; p = p->sibnext)
+      if(pid == -1 || p->pid == pid)
+        break;
+    if(p != 0){
+      // Found one.
+      unlinkchild(&curproc->zombies, p);
+      pid = p->pid;
+      if(status)
+        *status = p->killed != 0;
+      kfree(p->kstack);
+      p->kstack = 0;
+      freevm(p->pgdir);
+      putsession(p->session);
+      p->session = 0;
+      unhashpid(p);
+      p->pid = 0;
+      p->parent = 0;
+      p->name[0] = 0;
+      p->killed = 0;
+      freeslot(p);
+      release(&ptable.lock);
+      return pid;
     }
 
+    if(pid == -1)
+      havekids = curproc->children != 0;
+    else
+      havekids = (q = findproc(pid)) != 0 && q->parent == curproc;
+
     // No point waiting if we don't have any children.
     if(!havekids || curproc->killed){
       release(&ptable.lock);
       return -1;
     }
+    if(options & WNOHANG){
+      release(&ptable.lock);
+      return 0;
+    }
 
     // Wait for children to exit.  (See wakeup1 call in proc_exit.)
     sleep(curproc, &ptable.lock);  //DOC: wait-sleep
@@ -893,10 +1515,103 @@ wait(void)
 //  - swtch to start running that process
 //  - eventually that process transfers control
 //      via swtch back to the scheduler.
+// Switch to chosen process.  It is the process's job
+// to release ptable.lock and then reacquire it
+// before jumping back to us.
+static void
+runproc(struct cpu *c, struct proc *p)
+{
+  c->util_avg = pelt_avg(c->util_avg, 0, c->pelt_last);
+  c->pelt_last = ticks;
+  c->proc = p;
+  if(p->lastcpu >= 0 && p->lastcpu != c - cpus){
+    p->nmigrations++;
+    trace(TRACE_MIGRATE, p, 0, p->lastcpu);
+  }
+  p->lastcpu = c - cpus;
+  switchuvm(p);
+  setstate(p, RUNNING);
+
+  swtch(&(c->scheduler), p->context);
+  switchkvm();
+
+  // Process is done running for now.
+  // It should have changed its p->state before coming back.
+  c->util_avg = pelt_avg(c->util_avg, 1024, c->pelt_last);
+  c->pelt_last = ticks;
+  c->proc = 0;
+}
+
+// Consume the next-buddy hint left by yield_to().
+// Returns the buddy if it is still waiting to run, otherwise 0.
+// The ptable lock must be held.
+static struct proc*
+nextbuddy(void)
+{
+  struct proc *p = runnable_tasks->next;
+
+  runnable_tasks->next = 0;
+  if(p != 0 && p->state == RUNNABLE)
+    return p;
+  return 0;
+}
+
+// Choose the next process to run, or 0 if none is runnable.
+// A next-buddy goes first. Otherwise pick the runnable session
+// with the least weighted CPU time and take the member after the
+// one it ran last. The skip-buddy only runs if nothing else can.
+// The ptable lock must be held.
+static struct proc*
+pickproc(void)
+{
+  struct proc *p, *skip;
+  struct session *s, *best;
+  int i;
+
+  // A directed yield jumps the queue.
+  if((p = nextbuddy()) != 0)
+    return p;
+
+  skip = runnable_tasks->skip;
+  runnable_tasks->skip = 0;
+
+  best = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state != RUNNABLE || p == skip)
+      continue;
+    s = p->session;
+    // Don't let a session that sat idle bank unbounded credit.
+    if((int)(s->vruntime - (ptable.sessfloor - SESS_CREDIT)) < 0)
+      s->vruntime = ptable.sessfloor - SESS_CREDIT;
+    if(best == 0 || (int)(s->vruntime - best->vruntime) < 0)
+      best = s;
+  }
+  if(best == 0){
+    if(skip != 0 && skip->state == RUNNABLE)
+      return skip;
+    return 0;
+  }
+  if((int)(best->vruntime - ptable.sessfloor) > 0)
+    ptable.sessfloor = best->vruntime;
+
+  // Round-robin among the session's members.
+  p = best->last ? best->last : &ptable.proc[NPROC-1];
+  for(i = 0; i < NPROC; i++){
+    if(++p == &ptable.proc[NPROC])
+      p = ptable.proc;
+    if(p->state == RUNNABLE && p->session == best && p != skip)
+      break;
+  }
+  best->last = p;
+  return p;
+}
+
 void
 scheduler(void)
 {
   struct proc *p;
+  int prevpid = 0, prevvruntime = 0, prevstate = 0;
+  uint ran;
   struct cpu *c = mycpu();
   c->proc = 0;
   
@@ -904,28 +1619,26 @@ scheduler(void)
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
     acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->state != RUNNABLE)
-        continue;
-
-      // Switch to chosen process.  It is the process's job
-      // to release ptable.lock and then reacquire it
-      // before jumping back to us.
-      c->proc = p;
-      switchuvm(p);
-      p->state = RUNNING;
-
-      swtch(&(c->scheduler), p->context);
-      switchkvm();
-
-      // Process is done running for now.
-      // It should have changed its p->state before coming back.
-      c->proc = 0;
+    if((p = pickproc()) != 0){
+      tracepid(TRACE_SWITCH, p, prevpid, prevvruntime, prevstate);
+      ran = p->run_ticks;
+      runproc(c, p);
+      // Remember what ran by value: by the next switch its slot
+      // may have been reaped and reused.
+      prevpid = p->pid;
+      prevvruntime = (int)p->vruntime;
+      prevstate = p->state;
+      // Charge the ticks it ran to the session's share.
+      ran = p->run_ticks - ran;
+      p->session->vruntime += ran * (SESS_SLICE * 1024 / p->session->weight);
+      release(&ptable.lock);
+      continue;
     }
     release(&ptable.lock);
 
+    // Nothing to run: zero a page for kzalloc() while idle.
+    kzerofill();
   }
 }
 
@@ -956,16 +1669,63 @@ sched(void)
 }
 
 // Give up the CPU for one scheduling round.
+// Only the timer interrupt calls this, so it counts as preemption.
 void
 yield(void)
 {
   struct proc *p = myproc();
   acquire(&ptable.lock);  //DOC: yieldlock
-  p->state = RUNNABLE;
+  setstate(p, RUNNABLE);
+  p->nivcsw++;
   sched();
   release(&ptable.lock);
 }
 
+// Give up the CPU and ask the scheduler to pass over us once,
+// so any other runnable process goes first (skip-buddy).
+void
+sched_yield(void)
+{
+  struct proc *p = myproc();
+  acquire(&ptable.lock);
+  setstate(p, RUNNABLE);
+  p->nvcsw++;
+  runnable_tasks->skip = p;
+  sched();
+  release(&ptable.lock);
+}
+
+// Give up the CPU in favour of process pid, e.g. the holder of a
+// lock we are spinning on. If pid is waiting to run it becomes the
+// next-buddy and is picked ahead of everyone else; the caller's
+// session is charged a tick, as if it had run, so it cannot win
+// the CPU straight back by yielding repeatedly.
+// Returns 0 after yielding, -1 if pid is not a live process other
+// than the caller.
+int
+yield_to(int pid)
+{
+  struct proc *curproc = myproc();
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  p = findproc(pid);
+  if(p == 0 || p->state == ZOMBIE || p == curproc){
+    release(&ptable.lock);
+    return -1;
+  }
+
+  if(p->state == RUNNABLE){
+    runnable_tasks->next = p;
+    curproc->session->vruntime += SESS_SLICE * 1024 / curproc->session->weight;
+  }
+  setstate(curproc, RUNNABLE);
+  curproc->nvcsw++;
+  sched();
+  release(&ptable.lock);
+  return 0;
+}
+
 // A fork child's very first scheduling by scheduler()
 // will swtch here.  "Return" to user space.
 void
@@ -1012,7 +1772,8 @@ sleep(void *chan, struct spinlock *lk)
   }
   // Go to sleep.
   p->chan = chan;
-  p->state = SLEEPING;
+  setstate(p, SLEEPING);
+  p->nvcsw++;
 
   sched();
 
@@ -1028,15 +1789,18 @@ sleep(void *chan, struct spinlock *lk)
 
 //PAGEBREAK!
 // Wake up all processes sleeping on chan.
+// Only chan's sleep queue bucket is searched.
 // The ptable lock must be held.
 static void
 wakeup1(void *chan)
 {
-  struct proc *p;
+  struct proc *p, *next;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+  for(p = sleepqueue(chan)->head; p != 0; p = next){
+    next = p->sleepnext;
+    if(p->chan == chan)
+      setstate(p, RUNNABLE);
+  }
 }
 
 // Wake up all processes sleeping on chan.
@@ -1048,6 +1812,25 @@ wakeup(void *chan)
   release(&ptable.lock);
 }
 
+// Wake up the process that has slept longest on chan, if any.
+// For exclusive waits where every waiter would compete for the
+// same resource: the woken process must call wakeupone() again
+// if it leaves the resource available without taking it.
+void
+wakeupone(void *chan)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = sleepqueue(chan)->head; p != 0; p = p->sleepnext){
+    if(p->chan == chan){
+      setstate(p, RUNNABLE);
+      break;
+    }
+  }
+  release(&ptable.lock);
+}
+
 // Kill the process with the given pid.
 // Process won't exit until it returns
 // to user space (see trap in trap.c).
@@ -1057,15 +1840,13 @@ kill(int pid)
   struct proc *p;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  if((p = findproc(pid)) != 0){
+    p->killed = 1;
+    // Wake process from sleep if necessary.
+    if(p->state == SLEEPING)
+      setstate(p, RUNNABLE);
+    release(&ptable.lock);
+    return 0;
   }
   release(&ptable.lock);
   return -1;
@@ -1,5 +1,16 @@
-// Per-CPU state
+// Per-CPU time accounting, charged by trap().
+enum cpustat {
+  CPU_USER,     // Timer ticks that interrupted user code
+  CPU_SYS,      // Timer ticks that interrupted a process in the kernel
+  CPU_IDLE,     // Timer ticks that interrupted the idle scheduler loop
+  CPU_INTR,     // Device interrupts handled
+  NCPUSTAT
+};
+
+// Per-CPU state, one cache line or more each so CPUs don't
+// false-share each other's fields.
 struct cpu {
+  struct cpu *self;            // This struct, read through %gs by mycpu()
   uchar apicid;                // Local APIC ID
   struct context *scheduler;   // swtch() here to enter scheduler
   struct taskstate ts;         // Used by x86 to find stack for interrupt
@@ -8,7 +19,36 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
-};
+  uint pelt_last;              // Tick of the last utilization update
+  uint util_avg;               // Decayed fraction of time busy, 0..1024
+  uint stat[NCPUSTAT];         // Time accounting, see enum cpustat
+} __attribute__((aligned(CACHELINE)));
+
+// seginit() points %gs at this CPU's struct cpu, so finding it
+// takes a single load. Call with interrupts disabled, or the
+// process may be moved to another CPU before using the result.
+static inline struct cpu*
+mycpu(void)
+{
+  struct cpu *c;
+
+  asm volatile("movl %%gs:%c1, %0" : "=r" (c) :
+               "i" (__builtin_offsetof(struct cpu, self)));
+  return c;
+}
+
+// The process running on this CPU. A single load is atomic with
+// respect to interrupts, so no pushcli is needed: if we are moved
+// to another CPU, we are still the process running on it.
+static inline struct proc*
+myproc(void)
+{
+  struct proc *p;
+
+  asm volatile("movl %%gs:%c1, %0" : "=r" (p) :
+               "i" (__builtin_offsetof(struct cpu, proc)) : "memory");
+  return p;
+}
 
 struct proc_info {
   int pid;
@@ -16,6 +56,65 @@ struct proc_info {
   int weight;
   double vruntime;
   int curr_runtime;
+  int util_avg;     // Decayed fraction of time running, 0..1024
+  int runnable_avg; // Decayed fraction of time runnable, 0..1024
+  int load_avg;     // runnable_avg scaled by weight
+};
+
+// One entry of the getprocs() snapshot.
+struct proc_snapshot {
+  int pid;
+  int state;        // enum procstate
+  char name[16];
+  int nice_value;
+  int weight;
+  double vruntime;
+  uint runtime;     // Total ticks spent RUNNING
+  int cpu;          // CPU it is running on or last ran on, -1 if never run
+};
+
+struct cpu_load {
+  int util_avg;           // Decayed fraction of time this CPU was busy, 0..1024
+  int rq_load_avg;        // Decayed runnable weight of the run queue
+  int rq_runnable_weight; // Instantaneous runnable weight of the run queue
+};
+
+// Per-task scheduler statistics, returned by getschedstat().
+// Bump SCHEDSTAT_VERSION whenever the layout changes.
+#define SCHEDSTAT_VERSION 2
+
+struct schedstat {
+  int version;        // SCHEDSTAT_VERSION of the kernel that filled this in
+  int pid;
+  uint run_ticks;     // Total ticks spent RUNNING
+  uint wait_ticks;    // Total ticks spent RUNNABLE waiting for a CPU
+  uint max_wait;      // Longest single wait for a CPU, in ticks
+  uint nvcsw;         // Voluntary context switches (sleep, yield calls)
+  uint nivcsw;        // Involuntary context switches (timer preemption)
+  uint nmigrations;   // Times it was run on a different CPU than before
+  uint noverruns;     // Times it kept the CPU longer than its time slice
+  uint max_latency;   // Longest wait from RUNNABLE to RUNNING, in microseconds
+};
+
+// Wakeup-to-run latency histograms, one per CPU. Bucket 0 counts
+// latencies under 2us; bucket i > 0 counts [2^i, 2^(i+1)) us.
+#define NLATBUCKET 24
+
+struct latstat {
+  int ncpu;
+  uint hist[NCPU][NLATBUCKET];
+  uint max_us[NCPU];           // Worst latency seen on each CPU
+};
+
+// Load averages are fixed point with LOAD_FSHIFT fraction bits.
+#define LOAD_FSHIFT 11
+
+struct sysstat {
+  uint uptime;                 // Ticks since boot
+  uint loadavg[3];             // 1, 5 and 15 minute load averages
+  int nrunning;                // RUNNABLE and RUNNING processes now
+  int ncpu;
+  uint cpu[NCPU][NCPUSTAT];    // Per-CPU time accounting
 };
 
 struct rb_node_info {
@@ -32,7 +131,17 @@ extern int ncpu;
 int setnice(int pid, int nice_value);
 void gettreeinfo(int *count, int *total_weight, int *period);
 void getprocinfo(int pid, struct proc_info *info);
+int getprocs(struct proc_snapshot *buf, int max);
 int treebalanced(void);
+int waitpid(int pid, int *status, int options);
+int yield_to(int pid);
+void sched_yield(void);
+int setsid(void);
+int setsessnice(int sid, int nice_value);
+int getcpuload(int cpu, struct cpu_load *cl);
+void getsysstat(struct sysstat *st);
+int getschedstat(int pid, struct schedstat *st);
+void getlatency(struct latstat *ls, int reset);
 
 //PAGEBREAK: 17
 // Saved registers for kernel context switches.
@@ -53,8 +162,32 @@ struct context {
   uint eip;
 };
 
+// waitpid() options
+#define WNOHANG 1  // Return 0 instead of blocking if no child has exited
+
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// Autogroup: all processes of a session are scheduled as one group.
+// Sessions share the CPU in proportion to their weight, and the
+// processes inside a session take turns on the session's share.
+struct session {
+  int sid;                     // Session ID (pid of the leader), 0 if free
+  int nproc;                   // Processes in the session, zombies included
+  int nice_value;              // Per-session nice, sets the group weight
+  int weight;
+  uint vruntime;               // Weighted CPU time charged to the group
+  struct proc *last;           // Member that ran last, for round-robin
+};
+
+// A program segment that pagefault() reads in from the executable
+// page by page on first touch. Memory past filesz is zero (bss).
+struct segment {
+  uint va;                     // Page-aligned start address
+  uint memsz;                  // Bytes of memory it occupies
+  uint off;                    // Offset of its contents in the file
+  uint filesz;                 // Bytes that come from the file
+};
+
 //This enumerator will be used to determine the color of each process in the red-black tree
 enum procColor {RED, BLACK};	
 
@@ -73,6 +206,21 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  struct inode *exe;           // Executable seg[] is read from
+  struct segment seg[MAXSEG];  // Segments not yet read in whole
+  int nseg;
+  struct session *session;     // Autogroup this process is scheduled in
+  struct proc *pidnext;        // Next process in the same pid hash chain
+  struct proc *freenext;       // Next UNUSED slot on the free list
+  struct proc *children;       // Live children
+  struct proc *zombies;        // Exited children not yet waited for
+  struct proc *sibnext;        // Links in the parent's children or zombies
+  struct proc *sibprev;
+  struct proc *sleepnext;      // Links in the sleep queue of chan's hash bucket
+  struct proc *sleepprev;
+  uint wakeat;                 // Tick sleepticks() is waiting for
+  struct proc *timernext;      // Links in the timer wheel, see timer.c
+  struct proc **timerpprev;    // 0 if the timer is not armed
   
   // members for CFS
   double vruntime;    	// Time elapsed since the process was created
@@ -81,6 +229,25 @@ struct proc {
   int nice_value;		// Used to determine the process's priority
   int weight;		// Used to determine the process's maximum execution time
 
+  // members for load tracking
+  uint pelt_last;	// Tick of the last load update
+  uint util_avg;	// Decayed fraction of time running, 0..1024
+  uint runnable_avg;	// Decayed fraction of time runnable or running, 0..1024
+  uint load_avg;	// runnable_avg scaled by weight
+
+  // members for schedstats
+  uint state_since;	// Tick of the last state change
+  int lastcpu;		// CPU it last ran on, -1 if never
+  uint run_ticks;	// Total ticks spent RUNNING
+  uint wait_ticks;	// Total ticks spent RUNNABLE waiting for a CPU
+  uint max_wait;	// Longest single wait for a CPU
+  uint nvcsw;		// Voluntary context switches
+  uint nivcsw;		// Involuntary context switches
+  uint nmigrations;	// Times moved to a different CPU
+  uint noverruns;	// Times it ran past its time slice
+  uint64 runnable_tsc;	// TSC when it last became RUNNABLE
+  uint max_latency;	// Longest RUNNABLE to RUNNING wait, microseconds
+
   // members for red-black tree
 
   enum procColor color;
@@ -101,6 +268,12 @@ struct rbtree {
   int total_weight;
   struct proc *root;
   struct proc *min_vruntime;
+  struct proc *next;    // Next-buddy hint: run this task first (yield_to)
+  struct proc *skip;    // Skip-buddy hint: pass over this task once (sched_yield)
+  uint pelt_last;       // Tick of the last load update
+  uint load_avg;        // Decayed runnable_weight
+  int runnable_weight;  // Sum of weights of RUNNABLE and RUNNING tasks
+  int nr_running;       // Number of RUNNABLE and RUNNING tasks
 }; 
 
 struct rbtree* gettree(void);
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define MAXPROCS 64
+
+static char *states[] = {
+  [PROC_EMBRYO]   "embryo",
+  [PROC_SLEEPING] "sleep",
+  [PROC_RUNNABLE] "runble",
+  [PROC_RUNNING]  "run",
+  [PROC_ZOMBIE]   "zombie",
+};
+
+int
+main(void)
+{
+  static struct proc_snapshot procs[MAXPROCS];
+  int i, n;
+
+  n = getprocs(procs, MAXPROCS);
+  if(n < 0){
+    printf(2, "ps: getprocs failed\n");
+    exit();
+  }
+  printf(1, "PID\tSTATE\tNICE\tWEIGHT\tVRUN\tTICKS\tCPU\tNAME\n");
+  for(i = 0; i < n; i++){
+    printf(1, "%d\t%s\t%d\t%d\t%d\t%d\t%d\t%s\n", procs[i].pid,
+           procs[i].state > 0 && procs[i].state < sizeof(states)/sizeof(states[0]) ? states[procs[i].state] : "???",
+           procs[i].nice_value, procs[i].weight, (int)procs[i].vruntime,
+           procs[i].runtime, procs[i].cpu, procs[i].name);
+  }
+  exit();
+}
@@ -0,0 +1,86 @@
+// Run a command with scheduler tracing on and print the trace.
+//   schedtrace             print events recorded so far
+//   schedtrace cmd args    trace cmd from start to exit
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NEV (8*NTRACE)
+
+static struct trace_event ev[NEV];
+
+static char *types[] = {
+  [TRACE_SWITCH]  "switch",
+  [TRACE_WAKEUP]  "wakeup",
+  [TRACE_FORK]    "fork",
+  [TRACE_EXIT]    "exit",
+  [TRACE_MIGRATE] "migrate",
+  [TRACE_NICE]    "nice",
+};
+
+// Events come out grouped by CPU; merge them into time order.
+void
+sortevents(int n)
+{
+  struct trace_event e;
+  int i, j;
+
+  for(i = 1; i < n; i++){
+    e = ev[i];
+    for(j = i; j > 0 && ev[j-1].tsc > e.tsc; j--)
+      ev[j] = ev[j-1];
+    ev[j] = e;
+  }
+}
+
+void
+dump(void)
+{
+  int i, n;
+  uint64 t0;
+
+  n = readtrace(ev, NEV);
+  if(n < 0){
+    printf(2, "schedtrace: readtrace failed\n");
+    return;
+  }
+  sortevents(n);
+  t0 = n > 0 ? ev[0].tsc : 0;
+  for(i = 0; i < n; i++){
+    // Timestamps in units of 1024 cycles since the first event.
+    printf(1, "%d cpu%d %s pid %d vrt %d", (uint)((ev[i].tsc - t0) >> 10),
+           ev[i].cpu, types[ev[i].type], ev[i].pid, ev[i].vruntime);
+    if(ev[i].pid2)
+      printf(1, " pid2 %d vrt2 %d", ev[i].pid2, ev[i].vruntime2);
+    if(ev[i].type == TRACE_SWITCH || ev[i].type == TRACE_MIGRATE ||
+       ev[i].type == TRACE_NICE)
+      printf(1, " arg %d", ev[i].arg);
+    printf(1, "\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(argc > 1){
+    readtrace(ev, NEV);  // discard older events
+    settrace(1);
+    pid = fork();
+    if(pid < 0){
+      printf(2, "schedtrace: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv+1);
+      printf(2, "schedtrace: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+    settrace(0);
+  }
+  dump();
+  exit();
+}
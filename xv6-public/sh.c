@@ -164,8 +164,11 @@ main(void)
         printf(2, "cannot cd %s\n", buf+3);
       continue;
     }
-    if(fork1() == 0)
+    if(fork1() == 0){
+      // Each command line gets its own scheduling group.
+      setsid();
       runcmd(parsecmd(buf));
+    }
     wait();
   }
   exit();
@@ -0,0 +1,288 @@
+// Slab allocator for small kernel objects.
+//
+// A cache hands out objects of one size, carved from slab pages
+// obtained with kalloc(). Each slab page starts with a struct slab
+// header, so kcachefree() and kmfree() find an object's slab by
+// rounding its address down to the page. Slabs with free objects
+// are kept on the cache's partial list; a slab whose objects are
+// all free goes back to kalloc().
+//
+// Each CPU keeps a few free objects per cache that it allocates
+// and frees without taking the cache lock, moving OBJBATCH of them
+// to or from the slabs when it runs out or overflows.
+//
+// kmalloc() serves sizes up to 2048 bytes from power-of-two caches
+// starting at 16 bytes. Subsystems that allocate many objects of one
+// type create their own cache with kcachecreate().
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "slab.h"
+
+#define NOBJCACHE 16              // most free objects a CPU keeps per cache
+#define OBJBATCH  (NOBJCACHE/2)   // objects moved to or from the slabs at once
+#define KMALLOC_MIN 16
+#define KMALLOC_MAX 2048
+#define NKMALLOC  8               // size classes 16, 32, ..., 2048
+
+struct slab {
+  struct kcache *cache;
+  struct slab *next;              // Links on the cache's partial list
+  struct slab *prev;
+  void **freelist;                // Free objects, linked through their first word
+  int inuse;                      // Objects not on freelist
+};
+
+// Only touched by its own CPU, with interrupts off.
+struct objcache {
+  int n;
+  void *obj[NOBJCACHE];
+  uint allocs;
+  uint frees;
+  uint hits;
+} __attribute__((aligned(CACHELINE)));
+
+struct kcache {
+  char *name;
+  uint size;
+  uint perslab;
+  uint offset;                    // Of the first object in a slab page
+  struct spinlock lock;
+  struct slab *partial;           // Slabs with free objects
+  uint nslabs;
+  struct objcache cpu[NCPU];
+};
+
+static struct {
+  struct spinlock lock;           // Guards n
+  int n;
+  struct kcache cache[NKCACHE];
+} slabs;
+
+static struct kcache *kmalloccache[NKMALLOC];
+
+// Create a cache of objects of size bytes.
+struct kcache*
+kcachecreate(char *name, uint size)
+{
+  struct kcache *c;
+
+  size = (size + 7) & ~7;
+  if(size < sizeof(void*) || size > PGSIZE - sizeof(struct slab))
+    panic("kcachecreate: size");
+  acquire(&slabs.lock);
+  if(slabs.n == NKCACHE)
+    panic("kcachecreate: too many caches");
+  c = &slabs.cache[slabs.n++];
+  release(&slabs.lock);
+
+  c->name = name;
+  c->size = size;
+  c->offset = (sizeof(struct slab) + 7) & ~7;
+  c->perslab = (PGSIZE - c->offset) / size;
+  initlock(&c->lock, "slab");
+  return c;
+}
+
+void
+slabinit(void)
+{
+  static char *names[NKMALLOC] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024", "kmalloc-2048",
+  };
+  int i;
+
+  initlock(&slabs.lock, "slabs");
+  for(i = 0; i < NKMALLOC; i++)
+    kmalloccache[i] = kcachecreate(names[i], KMALLOC_MIN << i);
+}
+
+// Get a new slab page for c. The cache lock must be held.
+static struct slab*
+slabgrow(struct kcache *c)
+{
+  struct slab *s;
+  char *obj;
+  int i;
+
+  if((s = (struct slab*)kalloc()) == 0)
+    return 0;
+  s->cache = c;
+  s->inuse = 0;
+  s->freelist = 0;
+  obj = (char*)s + c->offset;
+  for(i = 0; i < c->perslab; i++, obj += c->size){
+    *(void**)obj = s->freelist;
+    s->freelist = (void**)obj;
+  }
+  s->prev = 0;
+  s->next = c->partial;
+  if(c->partial)
+    c->partial->prev = s;
+  c->partial = s;
+  c->nslabs++;
+  return s;
+}
+
+static void
+unlinkslab(struct kcache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+// Move up to n objects from c's slabs into oc.
+// Returns the number moved. The cache lock must be held.
+static int
+slabtake(struct kcache *c, struct objcache *oc, int n)
+{
+  struct slab *s;
+  int i;
+
+  for(i = 0; i < n; i++){
+    if((s = c->partial) == 0 && (s = slabgrow(c)) == 0)
+      break;
+    oc->obj[oc->n++] = s->freelist;
+    s->freelist = *s->freelist;
+    if(++s->inuse == c->perslab)
+      unlinkslab(c, s);   // now full
+  }
+  return i;
+}
+
+// Return the last n objects of oc to their slabs.
+// The cache lock must be held.
+static void
+slabgive(struct kcache *c, struct objcache *oc, int n)
+{
+  struct slab *s;
+  void **obj;
+
+  while(n-- > 0){
+    obj = oc->obj[--oc->n];
+    s = (struct slab*)PGROUNDDOWN((uint)obj);
+    if(s->inuse-- == c->perslab){
+      // Was full: back on the partial list.
+      s->prev = 0;
+      s->next = c->partial;
+      if(c->partial)
+        c->partial->prev = s;
+      c->partial = s;
+    }
+    *obj = s->freelist;
+    s->freelist = obj;
+    if(s->inuse == 0){
+      unlinkslab(c, s);
+      c->nslabs--;
+      kfree((char*)s);
+    }
+  }
+}
+
+// Allocate an object from c.
+// Returns 0 if the memory cannot be allocated.
+void*
+kcachealloc(struct kcache *c)
+{
+  struct objcache *oc;
+  void *obj;
+
+  pushcli();
+  oc = &c->cpu[cpuid()];
+  if(oc->n > 0)
+    oc->hits++;
+  else {
+    acquire(&c->lock);
+    slabtake(c, oc, OBJBATCH);
+    release(&c->lock);
+  }
+  obj = 0;
+  if(oc->n > 0){
+    obj = oc->obj[--oc->n];
+    oc->allocs++;
+  }
+  popcli();
+  return obj;
+}
+
+// Free an object allocated from c.
+void
+kcachefree(struct kcache *c, void *obj)
+{
+  struct objcache *oc;
+
+  if(((struct slab*)PGROUNDDOWN((uint)obj))->cache != c)
+    panic("kcachefree");
+  pushcli();
+  oc = &c->cpu[cpuid()];
+  if(oc->n == NOBJCACHE){
+    acquire(&c->lock);
+    slabgive(c, oc, OBJBATCH);
+    release(&c->lock);
+  }
+  oc->obj[oc->n++] = obj;
+  oc->frees++;
+  popcli();
+}
+
+// Allocate n bytes, n <= 2048.
+// Returns 0 if n is too big or memory cannot be allocated.
+void*
+kmalloc(uint n)
+{
+  int i;
+
+  for(i = 0; i < NKMALLOC; i++)
+    if(n <= KMALLOC_MIN << i)
+      return kcachealloc(kmalloccache[i]);
+  return 0;
+}
+
+// Free memory returned by kmalloc() or kcachealloc().
+void
+kmfree(void *obj)
+{
+  kcachefree(((struct slab*)PGROUNDDOWN((uint)obj))->cache, obj);
+}
+
+// Copy out statistics for up to max caches.
+// Returns the number copied.
+int
+getslabstat(struct slabstat *st, int max)
+{
+  struct kcache *c;
+  struct objcache *oc;
+  int i, n;
+
+  acquire(&slabs.lock);
+  n = slabs.n < max ? slabs.n : max;
+  release(&slabs.lock);
+
+  memset(st, 0, n * sizeof(*st));
+  for(i = 0; i < n; i++){
+    c = &slabs.cache[i];
+    safestrcpy(st[i].name, c->name, sizeof(st[i].name));
+    st[i].size = c->size;
+    st[i].perslab = c->perslab;
+    acquire(&c->lock);
+    st[i].nslabs = c->nslabs;
+    release(&c->lock);
+    for(oc = c->cpu; oc < &c->cpu[ncpu]; oc++){
+      st[i].allocs += oc->allocs;
+      st[i].frees += oc->frees;
+      st[i].cpuhits += oc->hits;
+    }
+    st[i].inuse = st[i].allocs - st[i].frees;
+  }
+  return n;
+}
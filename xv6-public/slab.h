@@ -0,0 +1,15 @@
+// Slab allocator statistics, one entry per cache, returned by
+// getslabstat().
+
+#define NKCACHE 24  // most caches, size classes included
+
+struct slabstat {
+  char name[16];
+  uint size;        // Object size in bytes
+  uint perslab;     // Objects per slab page
+  uint nslabs;      // Slab pages allocated
+  uint inuse;       // Objects allocated and not yet freed
+  uint allocs;
+  uint frees;
+  uint cpuhits;     // Allocations served from a per-CPU cache
+};
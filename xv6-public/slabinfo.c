@@ -0,0 +1,26 @@
+// Print kernel slab allocator statistics, one line per cache.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int
+main(void)
+{
+  static struct slabstat st[NKCACHE];
+  int i, n;
+
+  n = getslabstat(st, NKCACHE);
+  if(n < 0){
+    printf(2, "slabinfo: getslabstat failed\n");
+    exit();
+  }
+  printf(1, "NAME\t\tSIZE\tPERSLAB\tSLABS\tINUSE\tALLOCS\tFREES\tCPUHIT%%\n");
+  for(i = 0; i < n; i++){
+    printf(1, "%s\t%s%d\t%d\t%d\t%d\t%d\t%d\t%d\n", st[i].name,
+           strlen(st[i].name) < 8 ? "\t" : "", st[i].size, st[i].perslab,
+           st[i].nslabs, st[i].inuse, st[i].allocs, st[i].frees,
+           st[i].allocs ? st[i].cpuhits * 100 / st[i].allocs : 0);
+  }
+  exit();
+}
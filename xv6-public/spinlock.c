@@ -9,12 +9,194 @@
 #include "proc.h"
 #include "spinlock.h"
 
+// Pause iterations per waiter ahead of us between polls of the
+// lock word, so waiters far back in line leave the cache line alone.
+#define BACKOFF 50
+
+#ifdef LOCKSTAT
+// Lock statistics, kept per lock name. Each CPU updates only its
+// own counters, and only while holding the lock, so no locking is
+// needed; readers may see a slightly stale total.
+struct lockcpustat {
+  uint acquires;
+  uint contended;
+  uint spin_max;
+  uint hold_max;
+  uint64 spin_total;
+  uint64 hold_total;
+  uint sitepc[NLOCKSITE];
+  uint sitecount[NLOCKSITE];
+};
+
+struct lockclass {
+  char *name;
+  uint ninit;         // initlock() calls, see struct lockstat
+  struct lockcpustat cpu[NCPU];
+};
+
+static struct {
+  uint busy;   // Guards n; a spinlock can't, since initlock runs before mpinit
+  int n;
+  struct lockclass class[NLOCKCLASS];
+} lockclasses;
+
+// Find or add the class for locks named name.
+// Returns 0 if the table is full.
+static struct lockclass*
+lockclass(char *name)
+{
+  struct lockclass *c;
+
+  while(xchg(&lockclasses.busy, 1) != 0)
+    ;
+  for(c = lockclasses.class; c < &lockclasses.class[lockclasses.n]; c++)
+    if(strncmp(c->name, name, sizeof(((struct lockstat*)0)->name)) == 0)
+      break;
+  if(c == &lockclasses.class[NLOCKCLASS])
+    c = 0;
+  else if(c == &lockclasses.class[lockclasses.n]){
+    c->name = name;
+    lockclasses.n++;
+  }
+  if(c)
+    c->ninit++;
+  xchg(&lockclasses.busy, 0);
+  return c;
+}
+
+// Count a contended acquire from pc, evicting the least
+// contended call site if the table is full.
+static void
+recordsite(struct lockcpustat *s, uint pc)
+{
+  int i, min;
+
+  min = 0;
+  for(i = 0; i < NLOCKSITE; i++){
+    if(s->sitepc[i] == pc){
+      s->sitecount[i]++;
+      return;
+    }
+    if(s->sitecount[i] < s->sitecount[min])
+      min = i;
+  }
+  s->sitepc[min] = pc;
+  s->sitecount[min] = 1;
+}
+
+// Account an acquire of lk. start is the TSC when it began
+// waiting, or 0 if the lock was free.
+static void
+statacquire(struct spinlock *lk, uint64 start)
+{
+  struct lockcpustat *s;
+  uint spin;
+
+  lk->acquired = rdtsc();
+  if(lk->class == 0)
+    return;
+  s = &lk->class->cpu[lk->cpu - cpus];
+  s->acquires++;
+  if(start == 0)
+    return;
+  spin = lk->acquired - start;
+  s->contended++;
+  s->spin_total += spin;
+  if(spin > s->spin_max)
+    s->spin_max = spin;
+  recordsite(s, lk->pcs[0]);
+}
+
+// Account the hold time of lk, which is about to be released.
+static void
+statrelease(struct spinlock *lk)
+{
+  struct lockcpustat *s;
+  uint64 hold;
+
+  if(lk->class == 0)
+    return;
+  s = &lk->class->cpu[lk->cpu - cpus];
+  hold = rdtsc() - lk->acquired;
+  s->hold_total += hold;
+  if(hold > s->hold_max)
+    s->hold_max = (hold >> 32) ? 0xffffffff : hold;
+}
+
+// Copy out statistics for up to max lock names.
+// Returns the number copied.
+int
+getlockstat(struct lockstat *ls, int max)
+{
+  struct lockclass *c;
+  struct lockcpustat *s;
+  uint pc[NCPU*NLOCKSITE], count[NCPU*NLOCKSITE];
+  int i, j, k, n, nsite, best;
+
+  memset(ls, 0, max * sizeof(*ls));
+  while(xchg(&lockclasses.busy, 1) != 0)
+    ;
+  n = lockclasses.n < max ? lockclasses.n : max;
+  xchg(&lockclasses.busy, 0);
+
+  for(i = 0; i < n; i++){
+    c = &lockclasses.class[i];
+    safestrcpy(ls[i].name, c->name, sizeof(ls[i].name));
+    ls[i].ninit = c->ninit;
+    nsite = 0;
+    for(s = c->cpu; s < &c->cpu[ncpu]; s++){
+      ls[i].acquires += s->acquires;
+      ls[i].contended += s->contended;
+      ls[i].spin_total += s->spin_total;
+      ls[i].hold_total += s->hold_total;
+      if(s->spin_max > ls[i].spin_max)
+        ls[i].spin_max = s->spin_max;
+      if(s->hold_max > ls[i].hold_max)
+        ls[i].hold_max = s->hold_max;
+      // Merge this CPU's call sites into pc[] and count[].
+      for(j = 0; j < NLOCKSITE && s->sitecount[j]; j++){
+        for(k = 0; k < nsite && pc[k] != s->sitepc[j]; k++)
+          ;
+        if(k == nsite){
+          pc[nsite] = s->sitepc[j];
+          count[nsite++] = 0;
+        }
+        count[k] += s->sitecount[j];
+      }
+    }
+    // Keep the most contended sites.
+    for(j = 0; j < NLOCKSITE; j++){
+      best = -1;
+      for(k = 0; k < nsite; k++)
+        if(count[k] && (best < 0 || count[k] > count[best]))
+          best = k;
+      if(best < 0)
+        break;
+      ls[i].sitepc[j] = pc[best];
+      ls[i].sitecount[j] = count[best];
+      count[best] = 0;
+    }
+  }
+  return n;
+}
+#else
+int
+getlockstat(struct lockstat *ls, int max)
+{
+  return -1;
+}
+#endif
+
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
-  lk->locked = 0;
+  lk->next = 0;
+  lk->owner = 0;
   lk->cpu = 0;
+#ifdef LOCKSTAT
+  lk->class = lockclass(name);
+#endif
 }
 
 // Acquire the lock.
@@ -24,13 +206,26 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint ticket, ahead;
+  int i;
+#ifdef LOCKSTAT
+  uint64 start = 0;
+#endif
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // The xadd is atomic, so each CPU gets a distinct ticket.
+  ticket = xadd(&lk->next, 1);
+  while((ahead = ticket - *(volatile uint*)&lk->owner) != 0){
+#ifdef LOCKSTAT
+    if(start == 0)
+      start = rdtsc();
+#endif
+    for(i = ahead * BACKOFF; i > 0; i--)
+      pause();
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +235,9 @@ acquire(struct spinlock *lk)
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
   getcallerpcs(&lk, lk->pcs);
+#ifdef LOCKSTAT
+  statacquire(lk, start);
+#endif
 }
 
 // Release the lock.
@@ -48,6 +246,9 @@ release(struct spinlock *lk)
 {
   if(!holding(lk))
     panic("release");
+#ifdef LOCKSTAT
+  statrelease(lk);
+#endif
 
   lk->pcs[0] = 0;
   lk->cpu = 0;
@@ -59,10 +260,10 @@ release(struct spinlock *lk)
   // stores; __sync_synchronize() tells them both not to.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code can't use a C assignment, since it might
-  // not be atomic. A real OS would use C atomics here.
-  asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+  // Release the lock, equivalent to lk->owner++. Only the
+  // holder writes owner, so a plain store is enough, but it
+  // must be a single one. A real OS would use C atomics here.
+  asm volatile("movl %1, %0" : "+m" (lk->owner) : "r" (lk->owner + 1));
 
   popcli();
 }
@@ -91,7 +292,7 @@ holding(struct spinlock *lock)
 {
   int r;
   pushcli();
-  r = lock->locked && lock->cpu == mycpu();
+  r = lock->owner != lock->next && lock->cpu == mycpu();
   popcli();
   return r;
 }
@@ -1,11 +1,37 @@
 // Mutual exclusion lock.
+// Ticket lock: acquire() takes the next ticket and waits until
+// owner reaches it, so CPUs get the lock in the order they asked.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  uint next;         // Next ticket to hand out
+  uint owner;        // Ticket of the holder; free when owner == next
 
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
   uint pcs[10];      // The call stack (an array of program counters)
                      // that locked the lock.
+#ifdef LOCKSTAT
+  struct lockclass *class;  // Statistics shared by all locks of this name
+  uint64 acquired;          // TSC when the holder got the lock
+#endif
+};
+
+// Lock statistics for all spinlocks with the same name, as
+// returned by getlockstat(). Cycles are TSC cycles.
+#define NLOCKCLASS 32  // distinct lock names tracked
+#define NLOCKSITE  4   // call sites kept per name
+
+struct lockstat {
+  char name[16];
+  uint ninit;                  // initlock() calls with this name since boot;
+                               // never decreases, e.g. counts every pipe ever made
+  uint acquires;
+  uint contended;              // Acquires that had to wait
+  uint spin_max;               // Longest wait for the lock
+  uint hold_max;               // Longest time the lock was held
+  uint64 spin_total;
+  uint64 hold_total;
+  uint sitepc[NLOCKSITE];      // Callers with the most contended acquires
+  uint sitecount[NLOCKSITE];
 };
 
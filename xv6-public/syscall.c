@@ -21,6 +21,8 @@ fetchint(uint addr, int *ip)
 
   if(addr >= curproc->sz || addr+4 > curproc->sz)
     return -1;
+  if(faultin(curproc, addr, 4, 0) < 0)
+    return -1;
   *ip = *(int*)(addr);
   return 0;
 }
@@ -39,6 +41,10 @@ fetchstr(uint addr, char **pp)
   *pp = (char*)addr;
   ep = (char*)curproc->sz;
   for(s = *pp; s < ep; s++){
+    // Fault each page in before reading it, see faultin().
+    if((s == *pp || (uint)s % PGSIZE == 0) &&
+       faultin(curproc, (uint)s, 1, 0) < 0)
+      return -1;
     if(*s == 0)
       return s - *pp;
   }
@@ -52,11 +58,8 @@ argint(int n, int *ip)
   return fetchint((myproc()->tf->esp) + 4 + 4*n, ip);
 }
 
-// Fetch the nth word-sized system call argument as a pointer
-// to a block of memory of size bytes.  Check that the pointer
-// lies within the process address space.
-int
-argptr(int n, char **pp, int size)
+static int
+argrange(int n, char **pp, int size, int write)
 {
   int i;
   struct proc *curproc = myproc();
@@ -65,10 +68,30 @@ argptr(int n, char **pp, int size)
     return -1;
   if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
     return -1;
+  if(faultin(curproc, i, size, write) < 0)
+    return -1;
   *pp = (char*)i;
   return 0;
 }
 
+// Fetch the nth word-sized system call argument as a pointer
+// to a block of memory of size bytes that the system call may
+// write.  Check that the pointer lies within the process address
+// space, and make the pages present and private.
+int
+argptr(int n, char **pp, int size)
+{
+  return argrange(n, pp, size, 1);
+}
+
+// Like argptr(), for a block the system call only reads.
+// Shared pages stay shared.
+int
+argrdptr(int n, char **pp, int size)
+{
+  return argrange(n, pp, size, 0);
+}
+
 // Fetch the nth word-sized system call argument as a string pointer.
 // Check that the pointer is valid and the string is nul-terminated.
 // (There is no shared writable memory, so the string can't change
@@ -108,6 +131,22 @@ extern int sys_getprocinfo(void);
 extern int sys_gettreenodes(void);
 extern int sys_treebalanced(void);
 extern int sys_setnice(void);
+extern int sys_yield_to(void);
+extern int sys_sched_yield(void);
+extern int sys_setsid(void);
+extern int sys_setsessnice(void);
+extern int sys_getcpuload(void);
+extern int sys_getsysstat(void);
+extern int sys_getschedstat(void);
+extern int sys_settrace(void);
+extern int sys_readtrace(void);
+extern int sys_getlatency(void);
+extern int sys_getprocs(void);
+extern int sys_waitpid(void);
+extern int sys_nanosleep(void);
+extern int sys_getlockstat(void);
+extern int sys_getkmemstat(void);
+extern int sys_getslabstat(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -136,6 +175,22 @@ static int (*syscalls[])(void) = {
 [SYS_gettreenodes] sys_gettreenodes,
 [SYS_treebalanced] sys_treebalanced,
 [SYS_setnice] sys_setnice,
+[SYS_yield_to] sys_yield_to,
+[SYS_sched_yield] sys_sched_yield,
+[SYS_setsid] sys_setsid,
+[SYS_setsessnice] sys_setsessnice,
+[SYS_getcpuload] sys_getcpuload,
+[SYS_getsysstat] sys_getsysstat,
+[SYS_getschedstat] sys_getschedstat,
+[SYS_settrace] sys_settrace,
+[SYS_readtrace] sys_readtrace,
+[SYS_getlatency] sys_getlatency,
+[SYS_getprocs] sys_getprocs,
+[SYS_waitpid] sys_waitpid,
+[SYS_nanosleep] sys_nanosleep,
+[SYS_getlockstat] sys_getlockstat,
+[SYS_getkmemstat] sys_getkmemstat,
+[SYS_getslabstat] sys_getslabstat,
 };
 
 void
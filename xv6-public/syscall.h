@@ -25,3 +25,19 @@
 #define SYS_getprocinfo 24
 #define SYS_gettreenodes 25
 #define SYS_setnice 26
+#define SYS_yield_to 27
+#define SYS_sched_yield 28
+#define SYS_setsid 29
+#define SYS_setsessnice 30
+#define SYS_getcpuload 31
+#define SYS_getsysstat 32
+#define SYS_getschedstat 33
+#define SYS_settrace 34
+#define SYS_readtrace 35
+#define SYS_getlatency 36
+#define SYS_getprocs 37
+#define SYS_waitpid 38
+#define SYS_nanosleep 39
+#define SYS_getlockstat 40
+#define SYS_getkmemstat 41
+#define SYS_getslabstat 42
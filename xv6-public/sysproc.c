@@ -6,6 +6,10 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "spinlock.h"
+#include "kalloc.h"
+#include "slab.h"
+#include "trace.h"
 
 int
 sys_fork(void)
@@ -26,6 +30,30 @@ sys_wait(void)
   return wait();
 }
 
+int
+sys_waitpid(void)
+{
+  int pid, options, status, ret;
+  int *user_status;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  // A null status pointer means the caller doesn't want it; don't
+  // let argptr() make page 0 present and private for nothing.
+  if(argint(1, (int*)&user_status) < 0)
+    return -1;
+  if(user_status != 0 && argptr(1, (char**)&user_status, sizeof(int)) < 0)
+    return -1;
+  if(argint(2, &options) < 0)
+    return -1;
+
+  ret = waitpid(pid, &status, options);
+  if(ret > 0 && user_status != 0 &&
+     copyout(myproc()->pgdir, (uint)user_status, (char*)&status, sizeof(int)) < 0)
+    return -1;
+  return ret;
+}
+
 int
 sys_kill(void)
 {
@@ -60,21 +88,23 @@ int
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
-  return 0;
+  return sleepticks(n);
+}
+
+int
+sys_nanosleep(void)
+{
+  struct timespec *ts;
+
+  if(argrdptr(0, (void*)&ts, sizeof(*ts)) < 0)
+    return -1;
+  if(ts->tv_sec < 0 || ts->tv_sec > 0x7fffffff / (1000000 / TICKUS) - 1 ||
+     ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000)
+    return -1;
+  return nanosleep(ts->tv_sec, ts->tv_nsec);
 }
 
 // return how many clock tick interrupts have occurred
@@ -150,10 +180,12 @@ sys_gettreenodes(void)
 
   if(argint(0, &max_nodes) < 0)
     return -1;
-  if(argptr(1, &buf, max_nodes * sizeof(struct rb_node_info)) < 0)
+  if(max_nodes < 0 || argptr(1, &buf, max_nodes * sizeof(struct rb_node_info)) < 0)
     return -1;
+  if(max_nodes > NPROC)
+    max_nodes = NPROC;
 
-  struct rb_node_info *nodes = (struct rb_node_info*)kalloc();
+  struct rb_node_info *nodes = kmalloc(max_nodes * sizeof(struct rb_node_info));
   if(nodes == 0)
     return -1;
 
@@ -163,11 +195,11 @@ sys_gettreenodes(void)
 
 
   if(copyout(myproc()->pgdir, (uint)buf, (void*)nodes, node_index * sizeof(struct rb_node_info)) < 0){
-    kfree((char*)nodes);
+    kmfree(nodes);
     return -1;
   }
 
-  kfree((char*)nodes);
+  kmfree(nodes);
   return node_index;  // Return the number of nodes traversed
 }
 
@@ -211,4 +243,241 @@ int sys_setnice(void)
     return -1;
 
   return setnice(pid, nice_value);
-}
\ No newline at end of file
+}
+
+int
+sys_yield_to(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return yield_to(pid);
+}
+
+int
+sys_sched_yield(void)
+{
+  sched_yield();
+  return 0;
+}
+
+int
+sys_setsid(void)
+{
+  return setsid();
+}
+
+int
+sys_setsessnice(void)
+{
+  int sid;
+  int nice_value;
+
+  if(argint(0, &sid) < 0)
+    return -1;
+  if(argint(1, &nice_value) < 0)
+    return -1;
+
+  return setsessnice(sid, nice_value);
+}
+
+int
+sys_getcpuload(void)
+{
+  int cpu;
+  struct cpu_load *user_cl;
+  struct cpu_load cl;
+
+  if(argint(0, &cpu) < 0)
+    return -1;
+  if(argptr(1, (char**)&user_cl, sizeof(struct cpu_load)) < 0)
+    return -1;
+
+  if(getcpuload(cpu, &cl) < 0)
+    return -1;
+
+  if(copyout(myproc()->pgdir, (uint)user_cl, (void*)&cl, sizeof(struct cpu_load)) < 0)
+    return -1;
+  return 0;
+}
+
+int
+sys_getsysstat(void)
+{
+  struct sysstat *user_st;
+  struct sysstat st;
+
+  if(argptr(0, (char**)&user_st, sizeof(struct sysstat)) < 0)
+    return -1;
+
+  getsysstat(&st);
+
+  if(copyout(myproc()->pgdir, (uint)user_st, (void*)&st, sizeof(struct sysstat)) < 0)
+    return -1;
+  return 0;
+}
+
+int
+sys_getschedstat(void)
+{
+  int pid;
+  struct schedstat *user_st;
+  struct schedstat st;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  if(argptr(1, (char**)&user_st, sizeof(struct schedstat)) < 0)
+    return -1;
+
+  if(getschedstat(pid, &st) < 0)
+    return -1;
+
+  if(copyout(myproc()->pgdir, (uint)user_st, (void*)&st, sizeof(struct schedstat)) < 0)
+    return -1;
+  return 0;
+}
+
+int
+sys_settrace(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return settrace(on);
+}
+
+int
+sys_readtrace(void)
+{
+  int max;
+  char *buf;
+
+  if(argint(1, &max) < 0 || max < 0)
+    return -1;
+  if(argptr(0, &buf, max * sizeof(struct trace_event)) < 0)
+    return -1;
+  return readtrace(myproc()->pgdir, (uint)buf, max);
+}
+
+int
+sys_getlatency(void)
+{
+  struct latstat *user_ls;
+  struct latstat ls;
+  int reset;
+
+  if(argptr(0, (char**)&user_ls, sizeof(struct latstat)) < 0)
+    return -1;
+  if(argint(1, &reset) < 0)
+    return -1;
+
+  getlatency(&ls, reset);
+
+  if(copyout(myproc()->pgdir, (uint)user_ls, (void*)&ls, sizeof(struct latstat)) < 0)
+    return -1;
+  return 0;
+}
+
+int
+sys_getprocs(void)
+{
+  int max, n;
+  char *buf;
+  struct proc_snapshot *snap;
+
+  if(argint(1, &max) < 0 || max < 0)
+    return -1;
+  if(argptr(0, &buf, max * sizeof(struct proc_snapshot)) < 0)
+    return -1;
+  if(max > NPROC)
+    max = NPROC;
+
+  // A full table's worth fits in one page.
+  snap = (struct proc_snapshot*)kalloc();
+  if(snap == 0)
+    return -1;
+
+  n = getprocs(snap, max);
+
+  if(copyout(myproc()->pgdir, (uint)buf, (void*)snap, n * sizeof(struct proc_snapshot)) < 0){
+    kfree((char*)snap);
+    return -1;
+  }
+
+  kfree((char*)snap);
+  return n;
+}
+
+int
+sys_getlockstat(void)
+{
+  int max, n;
+  char *buf;
+  struct lockstat *ls;
+
+  if(argint(1, &max) < 0 || max < 0)
+    return -1;
+  if(argptr(0, &buf, max * sizeof(struct lockstat)) < 0)
+    return -1;
+  if(max > NLOCKCLASS)
+    max = NLOCKCLASS;
+
+  // Every lock name fits in one page.
+  ls = (struct lockstat*)kalloc();
+  if(ls == 0)
+    return -1;
+
+  n = getlockstat(ls, max);
+
+  if(n > 0 && copyout(myproc()->pgdir, (uint)buf, (void*)ls, n * sizeof(struct lockstat)) < 0)
+    n = -1;
+  kfree((char*)ls);
+  return n;
+}
+
+int
+sys_getkmemstat(void)
+{
+  struct kmemstat *user_st;
+  struct kmemstat st;
+
+  if(argptr(0, (char**)&user_st, sizeof(struct kmemstat)) < 0)
+    return -1;
+
+  getkmemstat(&st);
+
+  if(copyout(myproc()->pgdir, (uint)user_st, (void*)&st, sizeof(struct kmemstat)) < 0)
+    return -1;
+  return 0;
+}
+
+int
+sys_getslabstat(void)
+{
+  int max, n;
+  char *buf;
+  struct slabstat *st;
+
+  if(argint(1, &max) < 0 || max < 0)
+    return -1;
+  if(argptr(0, &buf, max * sizeof(struct slabstat)) < 0)
+    return -1;
+  if(max > NKCACHE)
+    max = NKCACHE;
+
+  st = kmalloc(NKCACHE * sizeof(struct slabstat));
+  if(st == 0)
+    return -1;
+
+  n = getslabstat(st, max);
+
+  if(copyout(myproc()->pgdir, (uint)buf, (void*)st, n * sizeof(struct slabstat)) < 0){
+    kmfree(st);
+    return -1;
+  }
+
+  kmfree(st);
+  return n;
+}
@@ -0,0 +1,109 @@
+#include "types.h"
+#include "user.h"
+
+#define NUM_HOGS 30
+#define WORKLOAD 100000000
+
+// Run the interactive workload in its own session and
+// return the ticks it took through the pipe.
+void
+interactive(int fd)
+{
+  int start, elapsed;
+
+  setsid();
+  start = uptime();
+  for(int j = 0; j < WORKLOAD; j++){
+    asm volatile("nop");
+  }
+  elapsed = uptime() - start;
+  write(fd, &elapsed, sizeof(elapsed));
+  exit();
+}
+
+int
+timed_interactive(void)
+{
+  int pipe_fds[2];
+  int elapsed = -1;
+
+  if(pipe(pipe_fds) < 0){
+    printf(1, "Pipe creation failed\n");
+    exit();
+  }
+  if(fork() == 0){
+    close(pipe_fds[0]);
+    interactive(pipe_fds[1]);
+  }
+  close(pipe_fds[1]);
+  read(pipe_fds[0], &elapsed, sizeof(elapsed));
+  close(pipe_fds[0]);
+  wait();
+  return elapsed;
+}
+
+int
+main(void)
+{
+  int pids[NUM_HOGS];
+  int ctl_fds[2];
+  int leader, base, loaded, i;
+  char c;
+
+  printf(1, "Starting Autogroup Test\n");
+
+  base = timed_interactive();
+  if(base < 1)
+    base = 1;
+  printf(1, "Interactive session alone: %d ticks\n", base);
+
+  if(pipe(ctl_fds) < 0){
+    printf(1, "Pipe creation failed\n");
+    exit();
+  }
+
+  // The hog session: one leader that sleeps on the pipe
+  // and NUM_HOGS members that spin until they are killed.
+  leader = fork();
+  if(leader < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(leader == 0){
+    close(ctl_fds[1]);
+    setsid();
+    for(i = 0; i < NUM_HOGS; i++){
+      pids[i] = fork();
+      if(pids[i] == 0){
+        while(1){
+          asm volatile("nop");
+        }
+      }
+    }
+    read(ctl_fds[0], &c, 1);
+    for(i = 0; i < NUM_HOGS; i++)
+      kill(pids[i]);
+    for(i = 0; i < NUM_HOGS; i++)
+      wait();
+    exit();
+  }
+  close(ctl_fds[0]);
+
+  sleep(10);  // Let the hogs get going
+  loaded = timed_interactive();
+  printf(1, "Interactive session next to %d hogs: %d ticks\n", NUM_HOGS, loaded);
+
+  close(ctl_fds[1]);
+  wait();
+
+  // With per-process fairness the interactive task would get about
+  // 1/(NUM_HOGS+1) of the CPU; as a group it should get about half.
+  if(loaded <= base * 4){
+    printf(1, "Test Passed: Interactive session kept its share next to the hog session\n");
+  } else {
+    printf(1, "Test Failed: Interactive session slowed down %d times\n", loaded / base);
+  }
+
+  printf(1, "Autogroup Test completed\n");
+  exit();
+}
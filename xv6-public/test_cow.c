@@ -0,0 +1,83 @@
+#include "types.h"
+#include "user.h"
+
+#define SIZE (1024*1024)
+
+int
+main(void)
+{
+  struct kmemstat before, after;
+  char *heap;
+  int i, pid, fd[2], used;
+  char ok;
+  int passed = 1;
+
+  printf(1, "Starting COW Test\n");
+
+  heap = sbrk(SIZE);
+  if(heap == (char*)-1){
+    printf(1, "sbrk failed\n");
+    exit();
+  }
+  for(i = 0; i < SIZE; i += 4096)
+    heap[i] = 'p';
+  if(pipe(fd) < 0){
+    printf(1, "Pipe failed\n");
+    exit();
+  }
+
+  getkmemstat(&before);
+  pid = fork();
+  if(pid < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    // The heap is shared, so forking took far fewer pages than it holds.
+    getkmemstat(&after);
+    used = before.nfree - after.nfree;
+    ok = used < SIZE / 4096 / 4;
+    if(!ok)
+      printf(1, "Test Failed: fork used %d pages for a %d page heap\n", used, SIZE / 4096);
+    // A system call writing into a shared page must copy it too.
+    if(read(fd[0], heap + 8192, 1) != 1 || heap[8192] != 'x')
+      ok = 0;
+    // Writes land in the child's copy only.
+    for(i = 0; i < SIZE; i += 4096){
+      if(i != 8192 && heap[i] != 'p')
+        ok = 0;
+      heap[i] = 'c';
+    }
+    write(fd[1], &ok, 1);
+    exit();
+  }
+  write(fd[1], "x", 1);
+  wait();
+  if(read(fd[0], &ok, 1) != 1 || !ok){
+    printf(1, "Test Failed: child did not see its own copy of the heap\n");
+    passed = 0;
+  }
+  for(i = 0; i < SIZE; i += 4096){
+    if(heap[i] != 'p'){
+      printf(1, "Test Failed: child's write reached the parent at %d\n", i);
+      passed = 0;
+      break;
+    }
+  }
+
+  close(fd[0]);
+  close(fd[1]);
+  getkmemstat(&after);
+  // The child's copies are gone again; the pipe and parent pages are back too.
+  if(after.nfree + 8 < before.nfree){
+    printf(1, "Test Failed: %d pages not freed after the child exited\n",
+           before.nfree - after.nfree);
+    passed = 0;
+  }
+
+  if(passed)
+    printf(1, "Test Passed: forked pages are copied on write\n");
+
+  printf(1, "COW Test completed\n");
+  exit();
+}
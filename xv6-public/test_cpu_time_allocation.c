@@ -9,6 +9,7 @@
 int
 main(void)
 {
+  struct latstat ls;
   int pids[NUM_PROCS];
   int nice_values[NUM_PROCS];
   int pipe_fds[2];  // Pipe for communication between parent and children
@@ -27,6 +28,7 @@ main(void)
   }
 
   printf(1, "Starting CPU Time Allocation Test with %d processes\n", NUM_PROCS);
+  getlatency(&ls, 1);  // Measure this test only
 
   // Fork child processes
   for(i = 0; i < NUM_PROCS; i++){
@@ -130,6 +132,8 @@ main(void)
     printf(1, "Test Failed: CPU time allocation not proportional to weights\n");
   }
 
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
   printf(1, "CPU Time Allocation Test completed\n");
   exit();
 }
@@ -0,0 +1,175 @@
+#include "types.h"
+#include "user.h"
+#include "fcntl.h"
+
+#define NPAGE 8
+
+// Initialized data and bss that exec leaves on disk until touched.
+char data[NPAGE*4096] = { 1 };
+char bss[NPAGE*4096];
+
+// Runs after exec: check the contents and that touching each
+// page of data and bss costs a page only now.
+static void
+child(int fd)
+{
+  struct kmemstat before, after;
+  char ok;
+  int i;
+
+  ok = 1;
+  getkmemstat(&before);
+  for(i = 1; i < NPAGE; i++){
+    if(data[i*4096] != 0 || bss[i*4096] != 0)
+      ok = 0;
+    data[i*4096] = bss[i*4096] = 'c';
+  }
+  getkmemstat(&after);
+  if(data[0] != 1)
+    ok = 0;
+  if(before.nfree - after.nfree < 2 * (NPAGE - 1) - 2){
+    printf(1, "Test Failed: touching %d pages used only %d\n",
+           2 * (NPAGE - 1), before.nfree - after.nfree);
+    ok = 0;
+  }
+  write(fd, &ok, 1);
+  exit();
+}
+
+// Copy file src to dst.
+static int
+copy(char *src, char *dst)
+{
+  char buf[512];
+  int in, out, n;
+
+  if((in = open(src, O_RDONLY)) < 0)
+    return -1;
+  if((out = open(dst, O_CREATE|O_RDWR)) < 0){
+    close(in);
+    return -1;
+  }
+  while((n = read(in, buf, sizeof(buf))) > 0)
+    write(out, buf, n);
+  close(in);
+  close(out);
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *args[4], fdarg[2], fdargs[3];
+  int pid, fd[2], ready[2], wfd;
+  char ok;
+  int passed = 1;
+
+  if(argc == 2){
+    child(argv[1][0] - '0');
+    exit();
+  }
+  if(argc == 3){
+    // Say we are running, then wait for the parent to finish.
+    write(argv[2][1] - '0', "r", 1);
+    read(argv[2][0] - '0', &ok, 1);
+    exit();
+  }
+
+  printf(1, "Starting Demand Paging Test\n");
+
+  if(pipe(fd) < 0){
+    printf(1, "Pipe failed\n");
+    exit();
+  }
+  fdarg[0] = '0' + fd[1];
+  fdarg[1] = 0;
+  args[0] = argv[0];
+  args[1] = fdarg;
+  args[2] = 0;
+
+  pid = fork();
+  if(pid < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(args[0], args);
+    printf(1, "exec failed\n");
+    exit();
+  }
+  wait();
+  if(read(fd[0], &ok, 1) != 1 || !ok){
+    printf(1, "Test Failed: exec'd child found data or bss wrong\n");
+    passed = 0;
+  }
+
+  // A forked child reads in pages the parent never touched.
+  data[3*4096] = 'p';
+  pid = fork();
+  if(pid < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    ok = data[0] == 1 && data[3*4096] == 'p' && data[5*4096] == 0 && bss[5*4096] == 0;
+    write(fd[1], &ok, 1);
+    exit();
+  }
+  wait();
+  if(read(fd[0], &ok, 1) != 1 || !ok){
+    printf(1, "Test Failed: forked child saw wrong data\n");
+    passed = 0;
+  }
+
+  // The file of a running program can't be written.
+  if(copy(argv[0], "tdcopy") < 0){
+    printf(1, "copy failed\n");
+    exit();
+  }
+  if(pipe(ready) < 0){
+    printf(1, "Pipe failed\n");
+    exit();
+  }
+  fdargs[0] = '0' + fd[0];
+  fdargs[1] = '0' + ready[1];
+  fdargs[2] = 0;
+  args[0] = "tdcopy";
+  args[1] = "w";
+  args[2] = fdargs;
+  args[3] = 0;
+  pid = fork();
+  if(pid < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(args[0], args);
+    printf(1, "exec failed\n");
+    exit();
+  }
+  read(ready[0], &ok, 1);
+  if((wfd = open("tdcopy", O_RDWR)) < 0 || write(wfd, "x", 1) != -1){
+    printf(1, "Test Failed: wrote the file of a running program\n");
+    passed = 0;
+  }
+  close(wfd);
+  write(fd[1], "x", 1);
+  wait();
+  if((wfd = open("tdcopy", O_RDWR)) < 0 || write(wfd, "x", 1) != 1){
+    printf(1, "Test Failed: could not write the file once it stopped running\n");
+    passed = 0;
+  }
+  close(wfd);
+  unlink("tdcopy");
+  close(ready[0]);
+  close(ready[1]);
+
+  close(fd[0]);
+  close(fd[1]);
+
+  if(passed)
+    printf(1, "Test Passed: exec reads in pages on first touch\n");
+
+  printf(1, "Demand Paging Test completed\n");
+  exit();
+}
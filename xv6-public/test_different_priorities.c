@@ -9,6 +9,7 @@
 int
 main(void)
 {
+  struct latstat ls;
   int pids[NUM_PROCS];
   int nice_values[NUM_PROCS] = {0, 10, 20};
   int i, j;
@@ -23,6 +24,7 @@ main(void)
   }
 
   printf(1, "Starting Different Priorities Test\n");
+  getlatency(&ls, 1);  // Measure this test only
 
   for(i = 0; i < NUM_PROCS; i++){
     pids[i] = fork();
@@ -102,6 +104,8 @@ main(void)
     printf(1, "Test Failed: CPU time not allocated proportionally to priority\n");
   }
 
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
   printf(1, "Different Priorities Test completed\n");
   exit();
 }
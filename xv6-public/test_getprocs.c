@@ -0,0 +1,75 @@
+#include "types.h"
+#include "user.h"
+
+#define NUM_PROCS 20
+#define MAXPROCS 64
+
+int
+main(void)
+{
+  static struct proc_snapshot procs[MAXPROCS];
+  int pids[NUM_PROCS];
+  int i, j, n, found;
+  int passed = 1;
+
+  printf(1, "Starting Process Snapshot Test\n");
+
+  for(i = 0; i < NUM_PROCS; i++){
+    pids[i] = fork();
+    if(pids[i] < 0){
+      printf(1, "Fork failed\n");
+      exit();
+    }
+    if(pids[i] == 0){
+      setnice(getpid(), i % 10);
+      sleep(1000);
+      exit();
+    }
+  }
+  sleep(10);  // Let the children set their nice values
+
+  n = getprocs(procs, MAXPROCS);
+  printf(1, "getprocs returned %d processes\n", n);
+
+  for(i = 0; i < NUM_PROCS; i++){
+    found = 0;
+    for(j = 0; j < n; j++){
+      if(procs[j].pid != pids[i])
+        continue;
+      found = 1;
+      if(procs[j].nice_value != i % 10 || strcmp(procs[j].name, "test_getprocs") != 0){
+        printf(1, "Test Failed: Wrong snapshot for process %d\n", pids[i]);
+        passed = 0;
+      }
+    }
+    if(!found){
+      printf(1, "Test Failed: Process %d missing from snapshot\n", pids[i]);
+      passed = 0;
+    }
+  }
+
+  found = 0;
+  for(j = 0; j < n; j++)
+    if(procs[j].pid == getpid() && procs[j].state == PROC_RUNNING)
+      found = 1;
+  if(!found){
+    printf(1, "Test Failed: Caller should appear as running\n");
+    passed = 0;
+  }
+
+  if(getprocs(procs, 2) != 2){
+    printf(1, "Test Failed: getprocs should stop at max entries\n");
+    passed = 0;
+  }
+
+  for(i = 0; i < NUM_PROCS; i++)
+    kill(pids[i]);
+  for(i = 0; i < NUM_PROCS; i++)
+    wait();
+
+  if(passed)
+    printf(1, "Test Passed: getprocs returned a complete snapshot\n");
+
+  printf(1, "Process Snapshot Test completed\n");
+  exit();
+}
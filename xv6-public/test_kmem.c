@@ -0,0 +1,80 @@
+#include "types.h"
+#include "user.h"
+
+#define NCHILD 20
+
+int
+main(void)
+{
+  struct kmemstat before, after;
+  uint hits, misses, zhits, cached;
+  int i, pid;
+  int passed = 1;
+
+  printf(1, "Starting Kmem Test\n");
+
+  getkmemstat(&before);
+  for(i = 0; i < NCHILD; i++){
+    pid = fork();
+    if(pid < 0){
+      printf(1, "Fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      sbrk(16 * 4096);
+      exit();
+    }
+    wait();
+  }
+  getkmemstat(&after);
+
+  hits = misses = cached = 0;
+  for(i = 0; i < after.ncpu; i++){
+    hits += after.hits[i] - before.hits[i];
+    misses += after.misses[i] - before.misses[i];
+    cached += after.cached[i];
+    if(after.cached[i] > 64){
+      printf(1, "Test Failed: cpu %d magazine holds %d pages\n", i, after.cached[i]);
+      passed = 0;
+    }
+  }
+  // Zeroed pages come from the pool when it has them.
+  zhits = after.zhits - before.zhits;
+  if(hits + misses + zhits < NCHILD * 16){
+    printf(1, "Test Failed: only %d page allocations counted\n", hits + misses + zhits);
+    passed = 0;
+  }
+  if(hits <= misses){
+    printf(1, "Test Failed: %d magazine hits, %d misses\n", hits, misses);
+    passed = 0;
+  }
+  // Every child's pages came back, so free memory is unchanged.
+  if(after.nfree != before.nfree){
+    printf(1, "Test Failed: %d free pages before, %d after\n", before.nfree, after.nfree);
+    passed = 0;
+  }
+  if(cached > after.nfree){
+    printf(1, "Test Failed: more pages cached than free\n");
+    passed = 0;
+  }
+
+  // The buddy free lists, the magazines and the zeroed pool make up
+  // all free memory, and the freed pages merged back into large blocks.
+  cached += after.nzero;
+  for(i = 0; i < 11; i++)
+    cached += after.nfreeorder[i] << i;
+  if(cached != after.nfree){
+    printf(1, "Test Failed: free lists hold %d pages, nfree is %d\n", cached, after.nfree);
+    passed = 0;
+  }
+  if(after.nfreeorder[10] == 0){
+    printf(1, "Test Failed: no free 4MB blocks\n");
+    passed = 0;
+  }
+
+  if(passed)
+    printf(1, "Test Passed: page allocations are served per CPU\n");
+
+  printf(1, "Kmem Test completed\n");
+  exit();
+}
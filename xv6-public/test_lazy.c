@@ -0,0 +1,109 @@
+#include "types.h"
+#include "user.h"
+
+#define SIZE (8*1024*1024)
+
+int
+main(void)
+{
+  struct kmemstat before, after;
+  char *heap;
+  int i, pid, fd[2], used;
+  char ok;
+  int passed = 1;
+
+  printf(1, "Starting Lazy Sbrk Test\n");
+
+  // Growing the heap only reserves address space.
+  getkmemstat(&before);
+  heap = sbrk(SIZE);
+  if(heap == (char*)-1){
+    printf(1, "sbrk failed\n");
+    exit();
+  }
+  getkmemstat(&after);
+  used = before.nfree - after.nfree;
+  if(used > 8){
+    printf(1, "Test Failed: sbrk(%d) used %d pages up front\n", SIZE, used);
+    passed = 0;
+  }
+
+  // Touched pages appear zeroed, one page per touch.
+  getkmemstat(&before);
+  for(i = 0; i < SIZE; i += SIZE / 16){
+    if(heap[i] != 0){
+      printf(1, "Test Failed: new heap page at %d is not zero\n", i);
+      passed = 0;
+      break;
+    }
+    heap[i] = 'p';
+  }
+  getkmemstat(&after);
+  used = before.nfree - after.nfree;
+  if(used < 16 || used > 16 + 8){
+    printf(1, "Test Failed: touching 16 pages used %d\n", used);
+    passed = 0;
+  }
+
+  // A system call may be handed a page nobody has touched yet.
+  if(pipe(fd) < 0){
+    printf(1, "Pipe failed\n");
+    exit();
+  }
+  write(fd[1], "x", 1);
+  if(read(fd[0], heap + SIZE - 1, 1) != 1 || heap[SIZE - 1] != 'x'){
+    printf(1, "Test Failed: read() into an untouched heap page\n");
+    passed = 0;
+  }
+  write(fd[1], heap + SIZE / 2 + 4096, 1);
+  if(read(fd[0], &ok, 1) != 1 || ok != 0){
+    printf(1, "Test Failed: write() from an untouched heap page\n");
+    passed = 0;
+  }
+
+  // The child sees the touched pages and faults in the rest itself.
+  pid = fork();
+  if(pid < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    ok = heap[0] == 'p' && heap[SIZE - 1] == 'x' && heap[4096] == 0;
+    heap[4096] = 'c';
+    write(fd[1], &ok, 1);
+    exit();
+  }
+  wait();
+  if(read(fd[0], &ok, 1) != 1 || !ok){
+    printf(1, "Test Failed: child did not see the parent's heap\n");
+    passed = 0;
+  }
+  if(heap[4096] != 0){
+    printf(1, "Test Failed: child's write reached the parent\n");
+    passed = 0;
+  }
+
+  // More than physical memory can never be promised.
+  if(sbrk(0x7f000000) != (char*)-1){
+    printf(1, "Test Failed: sbrk beyond physical memory succeeded\n");
+    passed = 0;
+  }
+
+  // Shrinking gives back the pages that were touched.
+  getkmemstat(&before);
+  sbrk(-SIZE);
+  getkmemstat(&after);
+  if(after.nfree < before.nfree + 16){
+    printf(1, "Test Failed: shrinking freed %d pages\n", after.nfree - before.nfree);
+    passed = 0;
+  }
+
+  close(fd[0]);
+  close(fd[1]);
+
+  if(passed)
+    printf(1, "Test Passed: heap pages are allocated on first touch\n");
+
+  printf(1, "Lazy Sbrk Test completed\n");
+  exit();
+}
@@ -0,0 +1,59 @@
+#include "types.h"
+#include "user.h"
+
+// Returns the entry for lock name, or 0.
+static struct lockstat*
+find(struct lockstat *ls, int n, char *name)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+    if(strcmp(ls[i].name, name) == 0)
+      return &ls[i];
+  return 0;
+}
+
+int
+main(void)
+{
+  static struct lockstat before[NLOCKCLASS], after[NLOCKCLASS];
+  struct lockstat *b, *a;
+  int n, m, i;
+  int passed = 1;
+
+  printf(1, "Starting Lockstat Test\n");
+
+  n = getlockstat(before, NLOCKCLASS);
+  if(n < 0){
+    printf(1, "Test Passed: kernel built without LOCKSTAT\n");
+    printf(1, "Lockstat Test completed\n");
+    exit();
+  }
+  for(i = 0; i < 100; i++)
+    uptime();
+  m = getlockstat(after, NLOCKCLASS);
+
+  if(find(after, m, "ptable") == 0 || find(after, m, "bcache") == 0){
+    printf(1, "Test Failed: ptable or bcache lock not listed\n");
+    passed = 0;
+  }
+  b = find(before, n, "time");
+  a = find(after, m, "time");
+  if(b == 0 || a == 0){
+    printf(1, "Test Failed: tickslock not listed\n");
+    passed = 0;
+  } else if(a->acquires - b->acquires < 100){
+    printf(1, "Test Failed: 100 uptime() calls counted %d acquires\n",
+           a->acquires - b->acquires);
+    passed = 0;
+  } else if(a->contended > a->acquires || a->hold_max == 0){
+    printf(1, "Test Failed: inconsistent tickslock counters\n");
+    passed = 0;
+  }
+
+  if(passed)
+    printf(1, "Test Passed: lock statistics are collected per lock name\n");
+
+  printf(1, "Lockstat Test completed\n");
+  exit();
+}
@@ -7,11 +7,13 @@
 int
 main(void)
 {
+  struct latstat ls;
   int pid_high, pid_low;
   int pipe_fds[2];  // Pipe for communication between the low-priority process and parent
   int start_time_low, end_time_low;
 
   printf(1, "Starting Low-Priority Starvation Test\n");
+  getlatency(&ls, 1);  // Measure this test only
 
   // Create a pipe for communication
   if (pipe(pipe_fds) < 0) {
@@ -95,6 +97,8 @@ main(void)
     printf(1, "Test Failed: Low-priority process did not receive CPU time (starved)\n");
   }
 
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
   printf(1, "Low-Priority Starvation Test completed\n");
   exit();
 }
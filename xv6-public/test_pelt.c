@@ -0,0 +1,81 @@
+#include "types.h"
+#include "user.h"
+
+int
+main(void)
+{
+  int hog, sleeper;
+  struct proc_info hog_info, sleeper_info;
+  struct cpu_load cl;
+  int passed = 1;
+
+  printf(1, "Starting Load Tracking Test\n");
+
+  hog = fork();
+  if(hog < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(hog == 0){
+    while(1){
+      asm volatile("nop");
+    }
+  }
+
+  sleeper = fork();
+  if(sleeper < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(sleeper == 0){
+    sleep(1000);
+    exit();
+  }
+
+  sleep(100);  // About three half-lives of the load signal
+
+  if(getprocinfo(hog, &hog_info) < 0 || getprocinfo(sleeper, &sleeper_info) < 0){
+    printf(1, "Error: getprocinfo failed\n");
+    exit();
+  }
+  printf(1, "Hog: util %d runnable %d load %d\n",
+         hog_info.util_avg, hog_info.runnable_avg, hog_info.load_avg);
+  printf(1, "Sleeper: util %d runnable %d load %d\n",
+         sleeper_info.util_avg, sleeper_info.runnable_avg, sleeper_info.load_avg);
+
+  if(hog_info.runnable_avg < 700){
+    printf(1, "Test Failed: Busy process should look runnable most of the time\n");
+    passed = 0;
+  }
+  if(sleeper_info.runnable_avg > 100){
+    printf(1, "Test Failed: Sleeping process should carry almost no load\n");
+    passed = 0;
+  }
+
+  if(getcpuload(0, &cl) < 0){
+    printf(1, "Test Failed: getcpuload(0) failed\n");
+    passed = 0;
+  } else {
+    printf(1, "CPU 0: util %d rq load %d rq weight %d\n",
+           cl.util_avg, cl.rq_load_avg, cl.rq_runnable_weight);
+    if(cl.rq_load_avg < hog_info.weight / 2){
+      printf(1, "Test Failed: Run queue load should include the busy process\n");
+      passed = 0;
+    }
+  }
+  if(getcpuload(-1, &cl) != -1){
+    printf(1, "Test Failed: getcpuload() accepted a bad CPU number\n");
+    passed = 0;
+  }
+
+  kill(hog);
+  kill(sleeper);
+  wait();
+  wait();
+
+  if(passed)
+    printf(1, "Test Passed: Load signals track busy and idle processes\n");
+
+  printf(1, "Load Tracking Test completed\n");
+  exit();
+}
@@ -15,6 +15,7 @@ main(void)
   int pipe_fds[2];  // Pipe for passing start times and response times
   int nice_values[] = {-20, -10, 0, 10, 19};  // Wide range of nice values
   int i;
+  struct latstat ls;
 
   // Create a pipe for communication
   if (pipe(pipe_fds) < 0) {
@@ -23,6 +24,7 @@ main(void)
   }
 
   printf(1, "Starting Response Time Test\n");
+  getlatency(&ls, 1);  // Measure this test only
 
   // Fork all child processes with different nice values
   for(i = 0; i < NUM_PROCS; i++){
@@ -100,6 +102,10 @@ main(void)
     }
   }
 
+  // Wakeup-to-run latency across the whole run, from the kernel histograms.
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
+
   if(max_response_time <= NUM_PROCS*2 + NUM_PROCS/5){  // response time should be within the latency
     printf(1, "Test Passed: Processes scheduled promptly after creation\n");
   } else {
@@ -7,6 +7,7 @@
 int
 main(void)
 {
+  struct latstat ls;
   int pids[NUM_PROCS];
   int i, j;
   int exec_times[NUM_PROCS];
@@ -14,6 +15,7 @@ main(void)
   int pipefd[2];  // File descriptors for the pipe
 
   printf(1, "Starting Round-Robin Fairness Test\n");
+  getlatency(&ls, 1);  // Measure this test only
 
   // Create a pipe for IPC
   if(pipe(pipefd) < 0){
@@ -112,6 +114,8 @@ main(void)
     printf(1, "Test Failed: CPU time allocation unequal among equal-weight processes\n");
   }
 
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
   printf(1, "Round-Robin Fairness Test completed\n");
   exit();
 }
\ No newline at end of file
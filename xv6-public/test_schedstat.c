@@ -0,0 +1,82 @@
+#include "types.h"
+#include "user.h"
+
+#define NUM_HOGS 2
+
+int
+main(void)
+{
+  int hogs[NUM_HOGS];
+  int sleeper, i;
+  struct schedstat st;
+  int passed = 1;
+
+  printf(1, "Starting Schedstat Test\n");
+
+  for(i = 0; i < NUM_HOGS; i++){
+    hogs[i] = fork();
+    if(hogs[i] < 0){
+      printf(1, "Fork failed\n");
+      exit();
+    }
+    if(hogs[i] == 0){
+      while(1){
+        asm volatile("nop");
+      }
+    }
+  }
+
+  sleeper = fork();
+  if(sleeper < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(sleeper == 0){
+    for(i = 0; i < 20; i++)
+      sleep(1);
+    exit();
+  }
+
+  sleep(50);
+
+  for(i = 0; i < NUM_HOGS; i++){
+    if(getschedstat(hogs[i], &st) < 0){
+      printf(1, "Test Failed: getschedstat(%d) failed\n", hogs[i]);
+      passed = 0;
+      continue;
+    }
+    printf(1, "Hog %d: run %d wait %d maxwait %d vcsw %d ivcsw %d migrations %d overruns %d maxlat %dus\n",
+           st.pid, st.run_ticks, st.wait_ticks, st.max_wait, st.nvcsw, st.nivcsw,
+           st.nmigrations, st.noverruns, st.max_latency);
+    if(st.version != SCHEDSTAT_VERSION){
+      printf(1, "Test Failed: schedstat version %d, expected %d\n", st.version, SCHEDSTAT_VERSION);
+      passed = 0;
+    }
+    if(st.run_ticks == 0 || st.nivcsw == 0){
+      printf(1, "Test Failed: Busy process %d shows no run time or preemptions\n", st.pid);
+      passed = 0;
+    }
+  }
+
+  wait();  // The sleeper finishes first; it is a zombie now or soon
+  if(getschedstat(sleeper, &st) == 0){
+    printf(1, "Test Failed: getschedstat() found reaped process %d\n", sleeper);
+    passed = 0;
+  }
+
+  if(getschedstat(getpid(), &st) < 0 || st.nvcsw == 0){
+    printf(1, "Test Failed: Sleeping in the parent should count voluntary switches\n");
+    passed = 0;
+  }
+
+  for(i = 0; i < NUM_HOGS; i++)
+    kill(hogs[i]);
+  for(i = 0; i < NUM_HOGS; i++)
+    wait();
+
+  if(passed)
+    printf(1, "Test Passed: Schedstats reflect run, wait and switch behaviour\n");
+
+  printf(1, "Schedstat Test completed\n");
+  exit();
+}
@@ -7,6 +7,7 @@
 int
 main(void)
 {
+  struct latstat ls;
   int pids[NUM_PROCS];
   int nice_values[NUM_PROCS] = {-20, -15, -10, -5, 0, 5, 10};
   struct proc_info info[NUM_PROCS];
@@ -15,6 +16,7 @@ main(void)
   int start_time, end_time, init_time, response_time;
 
   printf(1, "Starting CFS scheduler test\n");
+  getlatency(&ls, 1);  // Measure this test only
   init_time = uptime();
 
   for(i = 0; i < NUM_PROCS; i++){
@@ -58,6 +60,8 @@ main(void)
     wait();
   }
 
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
   printf(1, "CFS scheduler test completed\n");
   exit();
 }
@@ -0,0 +1,75 @@
+#include "types.h"
+#include "user.h"
+
+#define NPIPES 20
+
+// Returns the entry for cache name, or 0.
+static struct slabstat*
+find(struct slabstat *st, int n, char *name)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+    if(strcmp(st[i].name, name) == 0)
+      return &st[i];
+  return 0;
+}
+
+int
+main(void)
+{
+  static struct slabstat before[NKCACHE], during[NKCACHE], after[NKCACHE];
+  struct slabstat *b, *d, *a;
+  int fds[NPIPES][2];
+  int i, n;
+  int passed = 1;
+
+  printf(1, "Starting Slab Test\n");
+
+  n = getslabstat(before, NKCACHE);
+  for(i = 0; i < NPIPES; i++){
+    if(pipe(fds[i]) < 0){
+      printf(1, "Pipe failed\n");
+      exit();
+    }
+  }
+  getslabstat(during, NKCACHE);
+  for(i = 0; i < NPIPES; i++){
+    close(fds[i][0]);
+    close(fds[i][1]);
+  }
+  getslabstat(after, NKCACHE);
+
+  if(find(before, n, "kmalloc-16") == 0 || find(before, n, "kmalloc-2048") == 0){
+    printf(1, "Test Failed: kmalloc size classes missing\n");
+    passed = 0;
+  }
+  b = find(before, n, "pipe");
+  d = find(during, n, "pipe");
+  a = find(after, n, "pipe");
+  if(b == 0 || d == 0 || a == 0){
+    printf(1, "Test Failed: no pipe cache\n");
+    passed = 0;
+  } else {
+    if(d->inuse != b->inuse + NPIPES){
+      printf(1, "Test Failed: %d pipes in use, expected %d\n", d->inuse, b->inuse + NPIPES);
+      passed = 0;
+    }
+    if(a->inuse != b->inuse){
+      printf(1, "Test Failed: %d pipes in use after closing, expected %d\n", a->inuse, b->inuse);
+      passed = 0;
+    }
+    // A pipe is much smaller than a page, so several share a slab.
+    if(d->perslab < 2 || d->nslabs * d->perslab < d->inuse){
+      printf(1, "Test Failed: %d slabs of %d pipes for %d pipes\n",
+             d->nslabs, d->perslab, d->inuse);
+      passed = 0;
+    }
+  }
+
+  if(passed)
+    printf(1, "Test Passed: pipes come from the slab allocator\n");
+
+  printf(1, "Slab Test completed\n");
+  exit();
+}
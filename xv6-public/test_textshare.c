@@ -0,0 +1,189 @@
+#include "types.h"
+#include "user.h"
+#include "fcntl.h"
+#include "elf.h"
+
+#define NPAGE 8
+
+// Read-only contents that every process running this binary
+// should share, and a data page each one writes to.
+const char table[NPAGE*4096] = { 1 };
+char data[2*4096] = { 1 };
+
+// Fork a child that execs path with the mode and the pipe's
+// write end as arguments, and read back the byte it sends.
+static int
+run(char *path, char *mode, int fd[2])
+{
+  char *args[4], fdarg[2];
+  char c;
+  int pid;
+
+  fdarg[0] = '0' + fd[1];
+  fdarg[1] = 0;
+  args[0] = path;
+  args[1] = mode;
+  args[2] = fdarg;
+  args[3] = 0;
+  pid = fork();
+  if(pid < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(path, args);
+    printf(1, "exec %s failed\n", path);
+    exit();
+  }
+  wait();
+  if(read(fd[0], &c, 1) != 1)
+    return -1;
+  return c;
+}
+
+// Runs after exec. Mode s: check that reading the table costs no
+// pages and that writing data gives a private copy. Mode r: report
+// a byte of the table.
+static void
+child(char *mode, int fd)
+{
+  struct kmemstat before, after;
+  char c;
+  int i, sum;
+
+  if(mode[0] == 'r'){
+    c = table[2*4096];
+    write(fd, &c, 1);
+    exit();
+  }
+  getkmemstat(&before);
+  sum = 0;
+  for(i = 0; i < NPAGE; i++)
+    sum += table[i*4096];
+  getkmemstat(&after);
+  c = sum == 1 && before.nfree - after.nfree <= 2;
+  if(!c)
+    printf(1, "Test Failed: reading %d shared pages used %d\n",
+           NPAGE, before.nfree - after.nfree);
+  data[4096] = 'c';
+  write(fd, &c, 1);
+  exit();
+}
+
+// Copy file src to dst.
+static int
+copy(char *src, char *dst)
+{
+  char buf[512];
+  int in, out, n;
+
+  if((in = open(src, O_RDONLY)) < 0)
+    return -1;
+  if((out = open(dst, O_CREATE|O_RDWR)) < 0){
+    close(in);
+    return -1;
+  }
+  while((n = read(in, buf, sizeof(buf))) > 0)
+    write(out, buf, n);
+  close(in);
+  close(out);
+  return 0;
+}
+
+// Overwrite the byte of file path that holds *addr once loaded.
+static int
+patch(char *path, const char *addr, char c)
+{
+  struct elfhdr elf;
+  struct proghdr ph;
+  char buf[512];
+  uint off;
+  int fd, n;
+
+  if((fd = open(path, O_RDWR)) < 0)
+    return -1;
+  if(read(fd, &elf, sizeof(elf)) != sizeof(elf))
+    goto bad;
+  // The program header follows the ELF header in xv6 binaries.
+  if(elf.phoff != sizeof(elf) || read(fd, &ph, sizeof(ph)) != sizeof(ph))
+    goto bad;
+  off = ph.off + ((uint)addr - ph.vaddr) - sizeof(elf) - sizeof(ph);
+  while(off > 0){
+    n = off < sizeof(buf) ? off : sizeof(buf);
+    if(read(fd, buf, n) != n)
+      goto bad;
+    off -= n;
+  }
+  if(write(fd, &c, 1) != 1)
+    goto bad;
+  close(fd);
+  return 0;
+
+bad:
+  close(fd);
+  return -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd[2], i, sum;
+  int passed = 1;
+
+  if(argc == 3){
+    child(argv[1], argv[2][0] - '0');
+    exit();
+  }
+
+  printf(1, "Starting Text Sharing Test\n");
+
+  if(pipe(fd) < 0){
+    printf(1, "Pipe failed\n");
+    exit();
+  }
+
+  // Bring the table and data into the page cache.
+  sum = 0;
+  for(i = 0; i < NPAGE; i++)
+    sum += table[i*4096];
+  sum += data[4096];
+  if(sum != 1){
+    printf(1, "Test Failed: table or data read in wrong\n");
+    passed = 0;
+  }
+
+  if(run(argv[0], "s", fd) != 1)
+    passed = 0;
+  if(data[4096] != 0){
+    printf(1, "Test Failed: child's write reached the parent\n");
+    passed = 0;
+  }
+
+  // Writing the file must drop its cached pages.
+  if(copy(argv[0], "tscopy") < 0){
+    printf(1, "copy failed\n");
+    exit();
+  }
+  if(run("tscopy", "r", fd) != 0){
+    printf(1, "Test Failed: copy of the binary read wrong\n");
+    passed = 0;
+  }
+  if(patch("tscopy", &table[2*4096], 'z') < 0){
+    printf(1, "patch failed\n");
+    exit();
+  }
+  if(run("tscopy", "r", fd) != 'z'){
+    printf(1, "Test Failed: stale page after the binary was written\n");
+    passed = 0;
+  }
+  unlink("tscopy");
+
+  close(fd[0]);
+  close(fd[1]);
+
+  if(passed)
+    printf(1, "Test Passed: text pages are shared until the file is written\n");
+
+  printf(1, "Text Sharing Test completed\n");
+  exit();
+}
@@ -9,12 +9,14 @@
 int
 main(void)
 {
+  struct latstat ls;
   int i, j;
   int total_procs = NUM_LARGE_PROCS+NUM_SMALL_PROCS;
   int pids[total_procs];
   struct proc_info info[total_procs];
 
   printf(1, "Starting Throughput Test\n");
+  getlatency(&ls, 1);  // Measure this test only
 
   // Launch small workload processes
   for(i = 0; i < NUM_SMALL_PROCS; i++){
@@ -80,6 +82,8 @@ main(void)
     printf(1, "Test Failed: Throughput measurement failed\n");
   }
 
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
   printf(1, "Throughput Test completed\n");
   exit();
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "types.h"
+#include "user.h"
+#include "date.h"
+
+#define NSLEEPERS 20
+
+int
+main(void)
+{
+  struct schedstat before, after;
+  struct timespec ts;
+  int i, pid, start, elapsed;
+  int passed = 1;
+
+  printf(1, "Starting Timer Test\n");
+
+  // A crowd of sleepers with different deadlines must all wake on time.
+  start = uptime();
+  for(i = 0; i < NSLEEPERS; i++){
+    pid = fork();
+    if(pid < 0){
+      printf(1, "Fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      int t0 = uptime();
+      sleep(5 + i * 3);
+      if(uptime() - t0 < 5 + i * 3)
+        printf(1, "Test Failed: sleeper %d woke early\n", i);
+      exit();
+    }
+  }
+  for(i = 0; i < NSLEEPERS; i++)
+    wait();
+  elapsed = uptime() - start;
+  if(elapsed < 5 + (NSLEEPERS-1) * 3){
+    printf(1, "Test Failed: sleepers finished after %d ticks\n", elapsed);
+    passed = 0;
+  }
+
+  // A long sleep should not be woken on every tick.
+  getschedstat(getpid(), &before);
+  sleep(50);
+  getschedstat(getpid(), &after);
+  if(after.nvcsw - before.nvcsw > 3){
+    printf(1, "Test Failed: sleep(50) took %d context switches\n",
+           after.nvcsw - before.nvcsw);
+    passed = 0;
+  }
+
+  // 250ms is 25 ticks.
+  ts.tv_sec = 0;
+  ts.tv_nsec = 250000000;
+  start = uptime();
+  if(nanosleep(&ts) < 0){
+    printf(1, "Test Failed: nanosleep failed\n");
+    passed = 0;
+  }
+  elapsed = uptime() - start;
+  if(elapsed < 24 || elapsed > 30){
+    printf(1, "Test Failed: 250ms nanosleep took %d ticks\n", elapsed);
+    passed = 0;
+  }
+
+  ts.tv_nsec = 1000000000;
+  if(nanosleep(&ts) != -1){
+    printf(1, "Test Failed: nanosleep accepted tv_nsec of one second\n");
+    passed = 0;
+  }
+
+  if(passed)
+    printf(1, "Test Passed: timers wake sleepers when due\n");
+
+  printf(1, "Timer Test completed\n");
+  exit();
+}
@@ -8,6 +8,7 @@
 int
 main(void)
 {
+  struct latstat ls;
   int pids[INITIAL_PROCS + LATER_PROCS];
   int i, j;
   int total_procs = INITIAL_PROCS + LATER_PROCS;
@@ -15,6 +16,7 @@ main(void)
   int pipefd[2];  // File descriptors for the pipe
 
   printf(1, "Starting Fairness Under Varying Loads Test\n");
+  getlatency(&ls, 1);  // Measure this test only
 
   // Create a pipe for IPC
   if(pipe(pipefd) < 0){
@@ -153,6 +155,8 @@ main(void)
     printf(1, "Test Failed: Fairness not maintained under varying loads\n");
   }
 
+  getlatency(&ls, 0);
+  printlatency(1, &ls);
   printf(1, "Fairness Under Varying Loads Test completed\n");
   exit();
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "types.h"
+#include "user.h"
+
+int
+main(void)
+{
+  int fast, slow, victim, status, ret;
+  int passed = 1;
+
+  printf(1, "Starting Waitpid Test\n");
+
+  fast = fork();
+  if(fast == 0){
+    sleep(5);
+    exit();
+  }
+  slow = fork();
+  if(slow == 0){
+    sleep(50);
+    exit();
+  }
+  victim = fork();
+  if(victim == 0){
+    while(1){
+      sleep(1);
+    }
+  }
+  if(fast < 0 || slow < 0 || victim < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+
+  // Nobody has exited yet.
+  if((ret = waitpid(slow, &status, WNOHANG)) != 0){
+    printf(1, "Test Failed: waitpid(WNOHANG) on a running child returned %d\n", ret);
+    passed = 0;
+  }
+
+  // Waiting for the slow child must not return the fast one.
+  if((ret = waitpid(slow, &status, 0)) != slow || status != 0){
+    printf(1, "Test Failed: waitpid(%d) returned %d status %d\n", slow, ret, status);
+    passed = 0;
+  }
+
+  // By now the fast child is a zombie.
+  if((ret = waitpid(fast, &status, WNOHANG)) != fast){
+    printf(1, "Test Failed: waitpid(WNOHANG) missed exited child, got %d\n", ret);
+    passed = 0;
+  }
+
+  kill(victim);
+  if((ret = waitpid(-1, &status, 0)) != victim || status != 1){
+    printf(1, "Test Failed: killed child gave %d status %d\n", ret, status);
+    passed = 0;
+  }
+
+  if(waitpid(1, &status, WNOHANG) != -1){
+    printf(1, "Test Failed: waitpid() on a non-child should fail\n");
+    passed = 0;
+  }
+  if(wait() != -1){
+    printf(1, "Test Failed: wait() with no children should fail\n");
+    passed = 0;
+  }
+
+  if(passed)
+    printf(1, "Test Passed: waitpid reaps the requested children\n");
+
+  printf(1, "Waitpid Test completed\n");
+  exit();
+}
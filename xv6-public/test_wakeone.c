@@ -0,0 +1,74 @@
+#include "types.h"
+#include "user.h"
+
+#define NWRITER 4
+#define NREADER 4
+#define NBYTES  4096  // per writer, several times the pipe size
+#define CHUNK   100
+
+// Writers and readers share one pipe and are woken one at a time.
+// A lost wakeup leaves a reader or writer asleep and hangs the test.
+int
+main(void)
+{
+  int data[2], result[2];
+  int i, n, got, total;
+  char buf[CHUNK];
+  int passed = 1;
+
+  printf(1, "Starting Wake-One Test\n");
+
+  if(pipe(data) < 0 || pipe(result) < 0){
+    printf(1, "Pipe failed\n");
+    exit();
+  }
+
+  for(i = 0; i < NWRITER; i++){
+    if(fork() == 0){
+      close(data[0]);
+      close(result[0]);
+      close(result[1]);
+      memset(buf, 'a' + i, sizeof(buf));
+      for(n = 0; n < NBYTES; n += CHUNK)
+        write(data[1], buf, NBYTES - n < CHUNK ? NBYTES - n : CHUNK);
+      exit();
+    }
+  }
+  for(i = 0; i < NREADER; i++){
+    if(fork() == 0){
+      close(data[1]);
+      close(result[0]);
+      got = 0;
+      while((n = read(data[0], buf, 1 + i * 37)) > 0)
+        got += n;
+      write(result[1], &got, sizeof(got));
+      exit();
+    }
+  }
+  close(data[0]);
+  close(data[1]);
+  close(result[1]);
+
+  total = 0;
+  for(i = 0; i < NREADER; i++){
+    if(read(result[0], &got, sizeof(got)) != sizeof(got)){
+      printf(1, "Test Failed: reader %d did not report\n", i);
+      passed = 0;
+      break;
+    }
+    total += got;
+  }
+  for(i = 0; i < NWRITER + NREADER; i++)
+    wait();
+
+  if(total != NWRITER * NBYTES){
+    printf(1, "Test Failed: read %d bytes, expected %d\n", total, NWRITER * NBYTES);
+    passed = 0;
+  }
+
+  if(passed)
+    printf(1, "Test Passed: every byte reached a reader\n");
+
+  printf(1, "Wake-One Test completed\n");
+  exit();
+}
@@ -0,0 +1,94 @@
+#include "types.h"
+#include "user.h"
+
+#define NUM_YIELDS 100
+
+int
+main(void)
+{
+  struct sysstat ss;
+  int pid, i, n, fd[2];
+  char order[2];
+  int passed = 1;
+
+  printf(1, "Starting Directed Yield Test\n");
+
+  if(pipe(fd) < 0){
+    printf(1, "Pipe failed\n");
+    exit();
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf(1, "Fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    // Child stands in for a lock holder that keeps the CPU busy.
+    // Its first act marks that it has run.
+    write(fd[1], "c", 1);
+    while(1){
+      asm volatile("nop");
+    }
+    exit();
+  }
+
+  // On one CPU the target runs before the caller resumes, so its
+  // byte lands in the pipe ahead of ours. Nobody sleeps, so no
+  // wakeup can have put it there instead. With more CPUs the caller
+  // may keep running elsewhere, so only check that the target ran.
+  getsysstat(&ss);
+  if(yield_to(pid) != 0){
+    printf(1, "Test Failed: yield_to(%d) returned an error\n", pid);
+    passed = 0;
+  }
+  write(fd[1], "p", 1);
+  for(n = 0; n < 2; n += i)
+    if((i = read(fd[0], order + n, 2 - n)) <= 0)
+      break;
+  if(n != 2 || (order[0] != 'c' && order[1] != 'c')){
+    printf(1, "Test Failed: target never ran\n");
+    passed = 0;
+  } else if(ss.ncpu == 1 && order[0] != 'c'){
+    printf(1, "Test Failed: caller resumed before the target ran\n");
+    passed = 0;
+  }
+  close(fd[0]);
+  close(fd[1]);
+
+  // Donating to a live process must succeed every time.
+  for(i = 0; i < NUM_YIELDS; i++){
+    if(yield_to(pid) != 0){
+      printf(1, "Test Failed: yield_to(%d) returned an error\n", pid);
+      passed = 0;
+      break;
+    }
+  }
+
+  if(yield_to(getpid()) != -1){
+    printf(1, "Test Failed: yield_to() to self should fail\n");
+    passed = 0;
+  }
+  if(yield_to(-1) != -1){
+    printf(1, "Test Failed: yield_to() to a missing pid should fail\n");
+    passed = 0;
+  }
+  if(sched_yield() != 0){
+    printf(1, "Test Failed: sched_yield() returned an error\n");
+    passed = 0;
+  }
+
+  kill(pid);
+  wait();
+
+  if(yield_to(pid) != -1){
+    printf(1, "Test Failed: yield_to() to a reaped process should fail\n");
+    passed = 0;
+  }
+
+  if(passed)
+    printf(1, "Test Passed: yield_to and sched_yield behave as expected\n");
+
+  printf(1, "Directed Yield Test completed\n");
+  exit();
+}
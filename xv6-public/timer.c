@@ -0,0 +1,119 @@
+// Timer wheel for sleeping processes.
+//
+// A process sleeping until tick t is chained on slot t % NWHEEL.
+// Each tick the timer interrupt looks only at the current slot
+// and wakes the processes whose deadline has come; a deadline
+// more than NWHEEL ticks away just stays put for another lap.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+#define NWHEEL 256  // slots, a power of two
+
+static struct proc *wheel[NWHEEL];  // Protected by tickslock
+
+// Arm p's timer to fire at tick wakeat, unless it is already armed.
+// The tickslock must be held.
+static void
+timeradd(struct proc *p, uint wakeat)
+{
+  struct proc **pp = &wheel[wakeat & (NWHEEL-1)];
+
+  if(p->timerpprev)
+    return;
+  p->wakeat = wakeat;
+  p->timernext = *pp;
+  if(*pp)
+    (*pp)->timerpprev = &p->timernext;
+  p->timerpprev = pp;
+  *pp = p;
+}
+
+// Disarm p's timer if it has not fired. The tickslock must be held.
+static void
+timerdel(struct proc *p)
+{
+  if(p->timerpprev == 0)
+    return;
+  *p->timerpprev = p->timernext;
+  if(p->timernext)
+    p->timernext->timerpprev = p->timerpprev;
+  p->timernext = 0;
+  p->timerpprev = 0;
+}
+
+// Wake the processes whose timers are due. Called by the timer
+// interrupt after advancing ticks, with tickslock held.
+void
+timertick(void)
+{
+  struct proc *p, *next;
+
+  for(p = wheel[ticks & (NWHEEL-1)]; p != 0; p = next){
+    next = p->timernext;
+    if((int)(ticks - p->wakeat) >= 0){
+      timerdel(p);
+      wakeup(&p->wakeat);
+    }
+  }
+}
+
+// Sleep for n ticks. Returns -1 if the process is killed first.
+int
+sleepticks(int n)
+{
+  struct proc *p = myproc();
+  uint ticks0;
+
+  acquire(&tickslock);
+  ticks0 = ticks;
+  while(ticks - ticks0 < n){
+    if(p->killed){
+      timerdel(p);
+      release(&tickslock);
+      return -1;
+    }
+    timeradd(p, ticks0 + n);
+    sleep(&p->wakeat, &tickslock);
+  }
+  timerdel(p);
+  release(&tickslock);
+  return 0;
+}
+
+// Sleep for sec seconds and nsec nanoseconds. Whole ticks are
+// slept on the wheel; the rest of the time is waited out against
+// the TSC, yielding the CPU. Returns -1 if the process is killed.
+int
+nanosleep(int sec, int nsec)
+{
+  uint tickns = TICKUS * 1000;
+  uint tscperus = tscpertick / TICKUS;
+  uint n, rem;
+  uint64 deadline;
+
+  n = sec * (1000000 / TICKUS) + nsec / tickns;
+  rem = nsec % tickns;
+  if(tscperus == 0)  // TSC not calibrated yet
+    return sleepticks(n + (rem != 0));
+
+  deadline = rdtsc() + (uint64)n * tscpertick +
+    (uint64)(rem / 1000) * tscperus + (rem % 1000) * tscperus / 1000;
+  if(n > 1 && sleepticks(n - 1) < 0)
+    return -1;
+  while(rdtsc() + tscpertick < deadline)
+    if(sleepticks(1) < 0)
+      return -1;
+  while(rdtsc() < deadline){
+    if(myproc()->killed)
+      return -1;
+    sched_yield();
+  }
+  return 0;
+}
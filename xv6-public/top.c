@@ -0,0 +1,54 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+static char *statnames[] = { "user", "sys", "idle", "intr" };
+
+// Print a LOAD_FSHIFT fixed-point load average with two decimals.
+void
+printload(uint load)
+{
+  uint frac = ((load & ((1<<LOAD_FSHIFT)-1)) * 100) >> LOAD_FSHIFT;
+
+  printf(1, " %d.%s%d", load >> LOAD_FSHIFT, frac < 10 ? "0" : "", frac);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct sysstat prev, cur;
+  int i, j, n, interval;
+  uint total, delta;
+
+  n = argc > 1 ? atoi(argv[1]) : 1;
+  interval = argc > 2 ? atoi(argv[2]) : 100;
+
+  if(getsysstat(&prev) < 0){
+    printf(2, "top: getsysstat failed\n");
+    exit();
+  }
+  while(n-- > 0){
+    sleep(interval);
+    getsysstat(&cur);
+
+    printf(1, "up %d ticks, %d running, load average:", cur.uptime, cur.nrunning);
+    for(i = 0; i < 3; i++)
+      printload(cur.loadavg[i]);
+    printf(1, "\n");
+
+    // Per-CPU ticks since the previous sample, as percentages.
+    for(i = 0; i < cur.ncpu; i++){
+      total = 0;
+      for(j = 0; j < 3; j++)
+        total += cur.cpu[i][j] - prev.cpu[i][j];
+      printf(1, "cpu%d:", i);
+      for(j = 0; j < 3; j++){
+        delta = cur.cpu[i][j] - prev.cpu[i][j];
+        printf(1, " %d%% %s", total ? delta * 100 / total : 0, statnames[j]);
+      }
+      printf(1, ", %d %s\n", cur.cpu[i][3] - prev.cpu[i][3], statnames[3]);
+    }
+    prev = cur;
+  }
+  exit();
+}
@@ -0,0 +1,112 @@
+// Per-CPU scheduler trace rings.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "trace.h"
+
+int tracing;
+
+struct tracering {
+  uint head;                   // Next slot to write, only moved by its CPU
+  uint tail;                   // Next slot to read, only moved by readers
+  struct trace_event ev[NTRACE];
+};
+
+struct {
+  struct spinlock lock;        // Serializes readers; writers never take it
+  struct tracering ring[NCPU];
+} trace;
+
+void
+traceinit(void)
+{
+  initlock(&trace.lock, "trace");
+}
+
+// Append an event to this CPU's ring, overwriting the oldest
+// entry when full. Safe from any context, including with
+// ptable.lock held, since it takes no locks.
+void
+tracerecord(int type, struct proc *p, struct proc *p2, int arg)
+{
+  tracerecordpid(type, p, p2 ? p2->pid : 0, p2 ? (int)p2->vruntime : 0, arg);
+}
+
+// Like tracerecord(), with the other process given by value.
+void
+tracerecordpid(int type, struct proc *p, int pid2, int vruntime2, int arg)
+{
+  struct tracering *r;
+  struct trace_event *e;
+
+  pushcli();
+  r = &trace.ring[cpuid()];
+  e = &r->ev[r->head % NTRACE];
+  e->tsc = rdtsc();
+  e->type = type;
+  e->cpu = cpuid();
+  e->arg = arg;
+  e->pid = p ? p->pid : 0;
+  e->vruntime = p ? (int)p->vruntime : 0;
+  e->pid2 = pid2;
+  e->vruntime2 = vruntime2;
+  e->pad = 0;
+  // Publish the event before moving head past it.
+  __sync_synchronize();
+  r->head++;
+  popcli();
+}
+
+// Turn tracing on or off, returning the previous setting.
+int
+settrace(int on)
+{
+  int old = tracing;
+
+  tracing = on != 0;
+  return old;
+}
+
+// Copy up to max unread events from all CPU rings to user
+// address dst in pgdir, oldest first within each CPU. Events a
+// writer overwrote before they could be read are dropped.
+// Returns the number of events copied or -1.
+int
+readtrace(pde_t *pgdir, uint dst, int max)
+{
+  struct tracering *r;
+  struct trace_event e;
+  uint head;
+  int n;
+
+  n = 0;
+  acquire(&trace.lock);
+  for(r = trace.ring; r < &trace.ring[ncpu] && n < max; r++){
+    head = r->head;
+    __sync_synchronize();
+    // Slot head % NTRACE is the one the writer fills next, so at
+    // most NTRACE-1 events behind head are safe to read.
+    if(head - r->tail >= NTRACE)
+      r->tail = head - (NTRACE - 1);
+    for(; r->tail != head && n < max; r->tail++){
+      e = r->ev[r->tail % NTRACE];
+      // If the writer reached this slot while copying, e may be torn.
+      __sync_synchronize();
+      if(r->head - r->tail >= NTRACE)
+        continue;
+      if(copyout(pgdir, dst + n*sizeof(e), (char*)&e, sizeof(e)) < 0){
+        release(&trace.lock);
+        return -1;
+      }
+      n++;
+    }
+  }
+  release(&trace.lock);
+  return n;
+}
@@ -0,0 +1,38 @@
+// Scheduler event tracing.
+// Each CPU logs compact binary events into its own ring buffer.
+// The ring has a single writer (its CPU, with interrupts off), so
+// recording takes no locks; readers drain it with readtrace().
+
+#define NTRACE 256  // events per CPU ring, a power of two
+
+enum tracetype {
+  TRACE_SWITCH = 1,  // pid switched in; pid2 ran before it, arg = pid2's state after
+  TRACE_WAKEUP,      // pid made RUNNABLE from SLEEPING; pid2 did it
+  TRACE_FORK,        // pid created; pid2 is the parent
+  TRACE_EXIT,        // pid exited
+  TRACE_MIGRATE,     // pid runs on this CPU; arg = CPU it ran on before
+  TRACE_NICE,        // pid's nice value set to arg
+};
+
+struct trace_event {
+  uint64 tsc;        // Time-stamp counter when recorded
+  uchar type;        // enum tracetype
+  uchar cpu;         // CPU that recorded the event
+  short arg;         // Event-specific, see enum tracetype
+  int pid;
+  int pid2;          // Other process involved, 0 if none
+  int vruntime;      // pid's vruntime, truncated
+  int vruntime2;     // pid2's vruntime, truncated
+  int pad;
+};
+
+extern int tracing;
+
+// Record an event if tracing is on. Costs one branch when off.
+#define trace(type, p, p2, arg) \
+  do { if(tracing) tracerecord((type), (p), (p2), (arg)); } while(0)
+
+// Like trace(), naming the other process by its pid and vruntime,
+// for one that may no longer exist.
+#define tracepid(type, p, pid2, vruntime2, arg) \
+  do { if(tracing) tracerecordpid((type), (p), (pid2), (vruntime2), (arg)); } while(0)
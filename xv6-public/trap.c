@@ -13,6 +13,7 @@ struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
+uint tscpertick;  // TSC cycles per timer tick, measured on CPU 0
 
 void
 tvinit(void)
@@ -32,10 +33,44 @@ idtinit(void)
   lidt(idt, sizeof(idt));
 }
 
+// Keep a smoothed measure of TSC cycles per timer tick,
+// used to turn cycle counts into time.
+static void
+tsctick(void)
+{
+  static uint64 last;
+  uint64 now = rdtsc();
+
+  if(last != 0){
+    if(tscpertick == 0)
+      tscpertick = now - last;
+    else
+      tscpertick = (7*tscpertick + (uint)(now - last)) / 8;
+  }
+  last = now;
+}
+
+// Charge one timer tick to this CPU according to what it was
+// doing when the tick arrived.
+static void
+accttick(struct trapframe *tf)
+{
+  struct cpu *c = mycpu();
+
+  if((tf->cs&3) == DPL_USER)
+    c->stat[CPU_USER]++;
+  else if(c->proc)
+    c->stat[CPU_SYS]++;
+  else
+    c->stat[CPU_IDLE]++;
+}
+
 //PAGEBREAK: 41
 void
 trap(struct trapframe *tf)
 {
+  uint va;
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
@@ -51,12 +86,16 @@ trap(struct trapframe *tf)
     if(cpuid() == 0){
       acquire(&tickslock);
       ticks++;
-      wakeup(&ticks);
+      calcload();
+      tsctick();
+      timertick();
       release(&tickslock);
     }
+    accttick(tf);
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
+    mycpu()->stat[CPU_INTR]++;
     ideintr();
     lapiceoi();
     break;
@@ -64,10 +103,12 @@ trap(struct trapframe *tf)
     // Bochs generates spurious IDE1 interrupts.
     break;
   case T_IRQ0 + IRQ_KBD:
+    mycpu()->stat[CPU_INTR]++;
     kbdintr();
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_COM1:
+    mycpu()->stat[CPU_INTR]++;
     uartintr();
     lapiceoi();
     break;
@@ -78,6 +119,17 @@ trap(struct trapframe *tf)
     lapiceoi();
     break;
 
+  case T_PGFLT:
+    va = rcr2();
+    // Page faults come in through an interrupt gate, but resolving
+    // a user one may sleep reading the program from disk. Let
+    // interrupts in, as a system call does.
+    if((tf->cs&3) == DPL_USER)
+      sti();
+    if(myproc() != 0 && pagefault(myproc(), va, tf->err) == 0)
+      break;
+    // Not one we can resolve: treat it as any other fault.
+
   //PAGEBREAK: 13
   default:
     if(myproc() == 0 || (tf->cs&3) == 0){
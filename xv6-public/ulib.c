@@ -104,3 +104,39 @@ memmove(void *vdst, const void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// Upper bound in microseconds of the latency bucket that holds
+// percentile pct of all wakeup-to-run samples in ls.
+static uint
+latpercentile(struct latstat *ls, int pct)
+{
+  uint total = 0, seen = 0, want;
+  int b, c;
+
+  for(c = 0; c < ls->ncpu; c++)
+    for(b = 0; b < NLATBUCKET; b++)
+      total += ls->hist[c][b];
+  want = (total * pct + 99) / 100;
+  for(b = 0; b < NLATBUCKET; b++){
+    for(c = 0; c < ls->ncpu; c++)
+      seen += ls->hist[c][b];
+    if(seen >= want && seen > 0)
+      return 2 << b;
+  }
+  return 0;
+}
+
+// Print p50, p99 and max wakeup-to-run latency from a
+// getlatency() snapshot.
+void
+printlatency(int fd, struct latstat *ls)
+{
+  uint max_us = 0;
+  int i;
+
+  for(i = 0; i < ls->ncpu; i++)
+    if(ls->max_us[i] > max_us)
+      max_us = ls->max_us[i];
+  printf(fd, "Scheduling latency: p50 <= %d us, p99 <= %d us, max %d us\n",
+         latpercentile(ls, 50), latpercentile(ls, 99), max_us);
+}
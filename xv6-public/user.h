@@ -1,11 +1,122 @@
 struct stat;
 struct rtcdate;
+struct timespec;
+#define WNOHANG 1  // waitpid(): don't block if no child has exited
 struct proc_info {
   int pid;
   int nice_value;
   int weight;
   double vruntime;
   int curr_runtime;
+  int util_avg;     // Decayed fraction of time running, 0..1024
+  int runnable_avg; // Decayed fraction of time runnable, 0..1024
+  int load_avg;     // runnable_avg scaled by weight
+};
+// proc_snapshot states, the values of enum procstate in proc.h.
+#define PROC_EMBRYO   1
+#define PROC_SLEEPING 2
+#define PROC_RUNNABLE 3
+#define PROC_RUNNING  4
+#define PROC_ZOMBIE   5
+
+struct proc_snapshot {
+  int pid;
+  int state;        // PROC_EMBRYO .. PROC_ZOMBIE
+  char name[16];
+  int nice_value;
+  int weight;
+  double vruntime;
+  uint runtime;     // Total ticks spent RUNNING
+  int cpu;          // CPU it is running on or last ran on, -1 if never run
+};
+struct cpu_load {
+  int util_avg;           // Decayed fraction of time this CPU was busy, 0..1024
+  int rq_load_avg;        // Decayed runnable weight of the run queue
+  int rq_runnable_weight; // Instantaneous runnable weight of the run queue
+};
+#define SCHEDSTAT_VERSION 2
+struct schedstat {
+  int version;
+  int pid;
+  uint run_ticks;     // Total ticks spent RUNNING
+  uint wait_ticks;    // Total ticks spent RUNNABLE waiting for a CPU
+  uint max_wait;      // Longest single wait for a CPU, in ticks
+  uint nvcsw;         // Voluntary context switches
+  uint nivcsw;        // Involuntary context switches
+  uint nmigrations;   // Times moved to a different CPU
+  uint noverruns;     // Times it ran past its time slice
+  uint max_latency;   // Longest wait from RUNNABLE to RUNNING, in microseconds
+};
+#define NLATBUCKET 24  // bucket 0: < 2us, bucket i: [2^i, 2^(i+1)) us
+struct latstat {
+  int ncpu;
+  uint hist[8][NLATBUCKET];  // [NCPU]
+  uint max_us[8];
+};
+#define NTRACE 256  // events per CPU
+enum tracetype {
+  TRACE_SWITCH = 1,  // pid switched in; pid2 ran before it, arg = pid2's state after
+  TRACE_WAKEUP,      // pid made RUNNABLE from SLEEPING; pid2 did it
+  TRACE_FORK,        // pid created; pid2 is the parent
+  TRACE_EXIT,        // pid exited
+  TRACE_MIGRATE,     // pid runs on this CPU; arg = CPU it ran on before
+  TRACE_NICE,        // pid's nice value set to arg
+};
+struct trace_event {
+  uint64 tsc;
+  uchar type;
+  uchar cpu;
+  short arg;
+  int pid;
+  int pid2;
+  int vruntime;
+  int vruntime2;
+  int pad;
+};
+#define LOAD_FSHIFT 11
+struct sysstat {
+  uint uptime;
+  uint loadavg[3];  // 1, 5 and 15 minute, LOAD_FSHIFT fraction bits
+  int nrunning;
+  int ncpu;
+  uint cpu[8][4];   // [NCPU][user, sys, idle, intr]
+};
+struct kmemstat {
+  int ncpu;
+  uint nfree;       // free pages, magazines and zeroed pool included
+  uint nfreeorder[11];  // free blocks of 2^order pages, order 0..10
+  uint cached[8];   // [NCPU] pages in each CPU's magazine
+  uint hits[8];     // kalloc()s served from the magazine
+  uint misses[8];   // kalloc()s that refilled it from the free list
+  uint drains[8];   // kfree()s that spilled it to the free list
+  uint nzero;       // pages in the zeroed pool
+  uint zhits;       // kzalloc()s served from the pool
+  uint zmisses;     // kzalloc()s that had to zero a page
+};
+#define NKCACHE 24  // slab caches the kernel can have
+struct slabstat {
+  char name[16];
+  uint size;        // object size in bytes
+  uint perslab;     // objects per slab page
+  uint nslabs;      // slab pages allocated
+  uint inuse;       // objects allocated and not yet freed
+  uint allocs;
+  uint frees;
+  uint cpuhits;     // allocations served from a per-CPU cache
+};
+#define NLOCKCLASS 32  // lock names the kernel tracks
+#define NLOCKSITE 4
+struct lockstat {
+  char name[16];
+  uint ninit;       // initlock() calls with this name since boot
+  uint acquires;
+  uint contended;   // acquires that had to wait
+  uint spin_max;    // TSC cycles
+  uint hold_max;
+  uint64 spin_total;
+  uint64 hold_total;
+  uint sitepc[NLOCKSITE];     // most contended callers of acquire()
+  uint sitecount[NLOCKSITE];
 };
 struct rb_node_info {
   int pid;
@@ -43,6 +154,22 @@ int getprocinfo(int pid, struct proc_info *info);
 int gettreenodes(int max_nodes, struct rb_node_info *nodes);
 int treebalanced(void);
 int setnice(int pid, int nice_value);
+int waitpid(int pid, int *status, int options);
+int yield_to(int pid);
+int sched_yield(void);
+int setsid(void);
+int setsessnice(int sid, int nice_value);
+int getcpuload(int cpu, struct cpu_load *cl);
+int getsysstat(struct sysstat *st);
+int getschedstat(int pid, struct schedstat *st);
+int settrace(int on);
+int readtrace(struct trace_event *buf, int max);
+int getlatency(struct latstat *ls, int reset);
+int getprocs(struct proc_snapshot *buf, int max);
+int nanosleep(struct timespec *ts);
+int getlockstat(struct lockstat *buf, int max);
+int getkmemstat(struct kmemstat *st);
+int getslabstat(struct slabstat *buf, int max);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -57,3 +184,4 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+void printlatency(int, struct latstat*);
@@ -16,17 +16,31 @@ void
 seginit(void)
 {
   struct cpu *c;
+  int apicid;
+
+  // mycpu() needs %gs, so find this CPU's struct the slow way.
+  // APIC IDs are not guaranteed to be contiguous.
+  apicid = lapicid();
+  for(c = cpus; c < &cpus[ncpu] && c->apicid != apicid; c++)
+    ;
+  if(c == &cpus[ncpu])
+    panic("seginit: unknown apicid");
 
   // Map "logical" addresses to virtual addresses using identity map.
   // Cannot share a CODE descriptor for both kernel and user
   // because it would have to have DPL_USR, but the CPU forbids
   // an interrupt from CPL=0 to DPL=3.
-  c = &cpus[cpuid()];
   c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
   c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
   c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
   c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+
+  // Per-CPU data for mycpu() and myproc(). alltraps reloads
+  // %gs on every entry, since user code may change it.
+  c->self = c;
+  c->gdt[SEG_KCPU] = SEG(STA_W, c, sizeof(*c) - 1, 0);
   lgdt(c->gdt, sizeof(c->gdt));
+  loadgs(SEG_KCPU << 3);
 }
 
 // Return the address of the PTE in page table pgdir
@@ -42,10 +56,9 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
   if(*pde & PTE_P){
     pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
   } else {
-    if(!alloc || (pgtab = (pte_t*)kalloc()) == 0)
-      return 0;
     // Make sure all those PTE_P bits are zero.
-    memset(pgtab, 0, PGSIZE);
+    if(!alloc || (pgtab = (pte_t*)kzalloc()) == 0)
+      return 0;
     // The permissions here are overly generous, but they can
     // be further restricted by the permissions in the page table
     // entries, if necessary.
@@ -121,9 +134,8 @@ setupkvm(void)
   pde_t *pgdir;
   struct kmap *k;
 
-  if((pgdir = (pde_t*)kalloc()) == 0)
+  if((pgdir = (pde_t*)kzalloc()) == 0)
     return 0;
-  memset(pgdir, 0, PGSIZE);
   if (P2V(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
@@ -186,8 +198,7 @@ inituvm(pde_t *pgdir, char *init, uint sz)
 
   if(sz >= PGSIZE)
     panic("inituvm: more than a page");
-  mem = kalloc();
-  memset(mem, 0, PGSIZE);
+  mem = kzalloc();
   mappages(pgdir, 0, PGSIZE, V2P(mem), PTE_W|PTE_U);
   memmove(mem, init, sz);
 }
@@ -231,13 +242,12 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 
   a = PGROUNDUP(oldsz);
   for(; a < newsz; a += PGSIZE){
-    mem = kalloc();
+    mem = kzalloc();
     if(mem == 0){
       cprintf("allocuvm out of memory\n");
       deallocuvm(pgdir, newsz, oldsz);
       return 0;
     }
-    memset(mem, 0, PGSIZE);
     if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
       cprintf("allocuvm out of memory (2)\n");
       deallocuvm(pgdir, newsz, oldsz);
@@ -311,36 +321,169 @@ clearpteu(pde_t *pgdir, char *uva)
 }
 
 // Given a parent process's page table, create a copy
-// of it for a child.
+// of it for a child. The pages themselves are shared
+// copy-on-write: writable pages become read-only in both
+// and are copied by cowfault() when either side writes.
+// pgdir must be the current page table.
 pde_t*
 copyuvm(pde_t *pgdir, uint sz)
 {
   pde_t *d;
   pte_t *pte;
   uint pa, i, flags;
-  char *mem;
 
   if((d = setupkvm()) == 0)
     return 0;
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
-    if(!(*pte & PTE_P))
-      panic("copyuvm: page not present");
+    // Heap pages never touched are left for the child to fault in.
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0 || !(*pte & PTE_P))
+      continue;
+    if(*pte & PTE_W)
+      *pte = (*pte & ~PTE_W) | PTE_COW;
     pa = PTE_ADDR(*pte);
     flags = PTE_FLAGS(*pte);
-    if((mem = kalloc()) == 0)
-      goto bad;
-    memmove(mem, (char*)P2V(pa), PGSIZE);
-    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0) {
-      kfree(mem);
+    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
       goto bad;
-    }
+    krefinc(P2V(pa));
   }
+  lcr3(V2P(pgdir));  // flush the parent's now read-only mappings
   return d;
 
 bad:
   freevm(d);
+  lcr3(V2P(pgdir));
+  return 0;
+}
+
+// Give pgdir a private, writable copy of the copy-on-write
+// page at va. If nobody else shares the page any more, it is
+// just made writable again. Returns -1 if va is not a
+// copy-on-write user page or memory is exhausted.
+static int
+cowfault(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  uint pa;
+  char *mem;
+
+  if((pte = walkpgdir(pgdir, (void*)va, 0)) == 0)
+    return -1;
+  if((*pte & (PTE_P|PTE_U|PTE_COW)) != (PTE_P|PTE_U|PTE_COW))
+    return -1;
+  pa = PTE_ADDR(*pte);
+  if(krefcnt(P2V(pa)) > 1){
+    if((mem = kalloc()) == 0)
+      return -1;
+    memmove(mem, P2V(pa), PGSIZE);
+    *pte = V2P(mem) | PTE_FLAGS(*pte);
+    kfree(P2V(pa));
+  }
+  *pte = (*pte | PTE_W) & ~PTE_COW;
+  if(myproc() != 0 && myproc()->pgdir == pgdir)
+    lcr3(V2P(pgdir));
+  return 0;
+}
+
+// Map a zeroed page at va, a heap page that sbrk() promised
+// but nobody has touched yet.
+static int
+lazyfault(pde_t *pgdir, uint va)
+{
+  char *mem;
+
+  if((mem = kzalloc()) == 0)
+    return -1;
+  if(mappages(pgdir, (char*)PGROUNDDOWN(va), PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
+
+// Map a page at va holding its part of segment s of the
+// executable, from the page cache.
+static int
+filefault(struct proc *p, struct segment *s, uint va)
+{
+  char *mem;
+  uint off, n, flags;
+
+  va = PGROUNDDOWN(va);
+  off = va - s->va;
+  if(off < s->filesz){
+    // Reading may sleep, which a fault taken while holding a
+    // spinlock must not do. System calls call faultin() on their
+    // buffers before taking locks, so only a bug gets here.
+    if(mycpu()->ncli > 0)
+      return -1;
+    n = s->filesz - off;
+    if(n > PGSIZE)
+      n = PGSIZE;
+    // Shared with every process running the file until written.
+    ilock(p->exe);
+    mem = pcget(p->exe, s->off + off, n);
+    iunlock(p->exe);
+    flags = PTE_U|PTE_COW;
+  } else {
+    mem = kzalloc();
+    flags = PTE_W|PTE_U;
+  }
+  if(mem == 0)
+    return -1;
+  if(mappages(p->pgdir, (char*)va, PGSIZE, V2P(mem), flags) < 0){
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
+
+// Handle a page fault on address va in process p, with
+// error code err. Returns 0 if the access can be retried.
+// Faults from the kernel on user addresses come here too,
+// when a system call reads or writes user memory directly.
+int
+pagefault(struct proc *p, uint va, uint err)
+{
+  struct segment *s;
+  uint a;
+
+  if(va >= p->sz)
+    return -1;
+  if(!(err & FEC_PR)){
+    // Match the page, not the byte: the first touch of a segment's
+    // last page may land past memsz, in the same page.
+    a = PGROUNDDOWN(va);
+    for(s = p->seg; s < &p->seg[p->nseg]; s++)
+      if(a >= s->va && a - s->va < s->memsz)
+        return filefault(p, s, va);
+    return lazyfault(p->pgdir, va);
+  }
+  if(err & FEC_WR)
+    return cowfault(p->pgdir, va);
+  return -1;
+}
+
+// Fault in the pages of [va, va+n) in p that are not present
+// yet, and if write is set copy the copy-on-write ones, so a
+// system call can use them while holding locks and the kernel
+// never takes a fault it could fail to resolve. The range must
+// lie below p->sz.
+int
+faultin(struct proc *p, uint va, uint n, int write)
+{
+  uint a;
+  pte_t *pte;
+
+  for(a = PGROUNDDOWN(va); a < va + n; a += PGSIZE){
+    pte = walkpgdir(p->pgdir, (char*)a, 0);
+    if(pte == 0 || (*pte & PTE_P) == 0){
+      if(pagefault(p, a, 0) < 0)
+        return -1;
+      pte = walkpgdir(p->pgdir, (char*)a, 0);
+    }
+    if(write && (*pte & PTE_COW) && pagefault(p, a, FEC_PR|FEC_WR) < 0)
+      return -1;
+  }
   return 0;
 }
 
@@ -352,7 +495,7 @@ uva2ka(pde_t *pgdir, char *uva)
   pte_t *pte;
 
   pte = walkpgdir(pgdir, uva, 0);
-  if((*pte & PTE_P) == 0)
+  if(pte == 0 || (*pte & PTE_P) == 0)
     return 0;
   if((*pte & PTE_U) == 0)
     return 0;
@@ -367,10 +510,22 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
 {
   char *buf, *pa0;
   uint n, va0;
+  pte_t *pte;
 
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
+    // Fault the page in as the MMU would for a user write.
+    pte = walkpgdir(pgdir, (char*)va0, 0);
+    if(pte == 0 || (*pte & PTE_P) == 0){
+      if(myproc() == 0 || myproc()->pgdir != pgdir ||
+         pagefault(myproc(), va0, FEC_WR) < 0)
+        return -1;
+      // A file page comes in shared from the page cache.
+      pte = walkpgdir(pgdir, (char*)va0, 0);
+    }
+    if((*pte & PTE_COW) && cowfault(pgdir, va0) < 0)
+      return -1;
     pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;